@@ -20,6 +20,7 @@
 #include <linux/types.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
+#include <linux/seqlock.h>
 #include <dt-bindings/soc/google/gs-bts.h>
 #include <soc/google/exynos-pd.h>
 #include <soc/google/bts.h>
@@ -54,6 +55,10 @@ struct nocl_info {
 	const char *nocl_name;
 	u32 num_ip;
 	u32 peak_freq;
+	bool is_nocl2a;
+	unsigned int total_rd_bw;
+	unsigned int total_wr_bw;
+	unsigned int ip_peak_freq;
 	struct nocl_ip_info *nocl_ips;
 	struct list_head list;
 };
@@ -73,8 +78,15 @@ struct nocl_info {
  * @scen_node:	list node - contains structure about scenario
  *
  * @bts_bw:	struct bts_bw * - struct for saving bandwidth information
+ * @stats_seq:	per-client seqcount protecting the bandwidth histogram
  * @peak_bw:	currently max bandwidth
  * @total_bw:	current total bandwidth
+ * @total_read:	running sum of read bandwidth votes
+ * @total_write: running sum of write bandwidth votes
+ * @rt_bw:	running sum of RT bandwidth votes from RT clients
+ * @client_peak_bw: largest peak bandwidth voted by a single client
+ * @mif_freq:	MIF frequency currently requested through QoS
+ * @int_freq:	INT frequency currently requested through QoS
  *
  * This structure stores basic BTS information for QoS control
  *
@@ -99,15 +111,23 @@ struct bts_device {
 	struct list_head scen_node;
 
 	struct bts_bw *bts_bw;
+	seqcount_mutex_t *stats_seq;
 	const char **rt_names;
 	unsigned int peak_bw;
 	unsigned int total_bw;
+	unsigned int total_read;
+	unsigned int total_write;
+	unsigned int rt_bw;
+	unsigned int client_peak_bw;
+	unsigned int mif_freq;
+	unsigned int int_freq;
 	struct bus1_int_map *bus1_int_tbl;
 	unsigned int map_row_cnt;
 
 #if IS_ENABLED(CONFIG_SOC_ZUMA)
 	unsigned int num_nocl;
 	struct nocl_info *nocl_infos;
+	struct nocl_info **bw_nocl;
 #endif
 };
 
@@ -17,6 +17,7 @@
 #include <linux/device.h>
 #include <linux/string.h>
 #include <linux/list.h>
+#include <linux/seqlock.h>
 #include <linux/debugfs.h>
 #include <linux/syscore_ops.h>
 #include <linux/suspend.h>
@@ -72,40 +73,106 @@ static unsigned int bus1_to_int_freq(unsigned int freq)
 	return btsdev->bus1_int_tbl[i].int_freq;
 }
 
+#if IS_ENABLED(CONFIG_SOC_ZUMA)
+static inline unsigned int bts_nocl_ip_freq(unsigned int peak,
+					    unsigned int bus_width)
+{
+	return (peak / bus_width) * 100 / INT_UTIL;
+}
+
+static unsigned int bts_nocl_max_ip_freq(struct nocl_info *nocl)
+{
+	struct bts_bw *bw;
+	unsigned int freq, max_freq = 0;
+
+	list_for_each_entry(bw, &nocl->list, node) {
+		freq = bts_nocl_ip_freq(bw->peak, bw->bus_width);
+		if (max_freq < freq)
+			max_freq = freq;
+	}
+
+	return max_freq;
+}
+#else
+static unsigned int bts_max_client_peak(void)
+{
+	unsigned int i, peak = 0;
+
+	for (i = 0; i < btsdev->num_bts; i++) {
+		if (peak < btsdev->bts_bw[i].peak)
+			peak = btsdev->bts_bw[i].peak;
+	}
+
+	return peak;
+}
+#endif
+
+/*
+ * Fold the change of a single client vote into the running totals, so the
+ * DVFS request can be derived without walking every client. The maximum is
+ * only rescanned when the client holding it lowers its vote.
+ * Must be called with btsdev->lock held.
+ */
+static void bts_account_bw(unsigned int index, const struct bts_bw *old)
+{
+	struct bts_bw *bw = &btsdev->bts_bw[index];
+#if IS_ENABLED(CONFIG_SOC_ZUMA)
+	struct nocl_info *nocl = btsdev->bw_nocl[index];
+	unsigned int new_freq, old_freq;
+#endif
+
+	btsdev->total_read += bw->read - old->read;
+	btsdev->total_write += bw->write - old->write;
+	if (bw->is_rt)
+		btsdev->rt_bw += bw->rt - old->rt;
+
+#if IS_ENABLED(CONFIG_SOC_ZUMA)
+	if (!nocl)
+		return;
+
+	nocl->total_rd_bw += bw->read - old->read;
+	nocl->total_wr_bw += bw->write - old->write;
+
+	new_freq = bts_nocl_ip_freq(bw->peak, bw->bus_width);
+	old_freq = bts_nocl_ip_freq(old->peak, bw->bus_width);
+	if (new_freq >= nocl->ip_peak_freq)
+		nocl->ip_peak_freq = new_freq;
+	else if (old_freq == nocl->ip_peak_freq)
+		nocl->ip_peak_freq = bts_nocl_max_ip_freq(nocl);
+#else
+	if (bw->peak >= btsdev->client_peak_bw)
+		btsdev->client_peak_bw = bw->peak;
+	else if (old->peak == btsdev->client_peak_bw)
+		btsdev->client_peak_bw = bts_max_client_peak();
+#endif
+}
+
+/*
+ * Derive MIF and INT frequencies from the running totals and only send QoS
+ * requests for the domains whose resulting frequency actually changed.
+ * Must be called with btsdev->mutex_lock held.
+ */
 static void bts_calc_bw(void)
 {
-	unsigned int i;
-	unsigned int total_read = 0;
-	unsigned int total_write = 0;
-	unsigned int rt_bw = 0;
-	unsigned int mif_freq, int_freq, bus1_freq = 0;
+	unsigned int total_read = btsdev->total_read;
+	unsigned int total_write = btsdev->total_write;
+	unsigned int rt_bw = btsdev->rt_bw;
+	unsigned int mif_freq, int_freq = 0, bus1_freq = 0;
 #if IS_ENABLED(CONFIG_SOC_ZUMA)
-	struct bts_bw *bw;
-	unsigned int nocl_total_rd_bw;
-	unsigned int nocl_total_wr_bw;
+	struct nocl_info *nocl;
 	unsigned int nocl_peak_freq;
+	unsigned int i;
 	char buf[80];
 	ssize_t ret = 0;
 #endif
 
-	mutex_lock(&btsdev->mutex_lock);
+	lockdep_assert_held(&btsdev->mutex_lock);
 
+#if IS_ENABLED(CONFIG_SOC_ZUMA)
 	btsdev->peak_bw = 0;
-	btsdev->total_bw = 0;
-
-	for (i = 0; i < btsdev->num_bts; i++) {
-#if !IS_ENABLED(CONFIG_SOC_ZUMA)
-		if (btsdev->peak_bw < btsdev->bts_bw[i].peak)
-			btsdev->peak_bw = btsdev->bts_bw[i].peak;
+#else
+	btsdev->peak_bw = btsdev->client_peak_bw;
 #endif
-		/* Calculate total RT BW based on RT clients */
-		if (btsdev->bts_bw[i].is_rt)
-			rt_bw += btsdev->bts_bw[i].rt;
-
-		total_read += btsdev->bts_bw[i].read;
-		total_write += btsdev->bts_bw[i].write;
-	}
-
 	btsdev->total_bw = total_read + total_write;
 	if (btsdev->peak_bw < (total_read / NUM_CHANNEL))
 		btsdev->peak_bw = (total_read / NUM_CHANNEL);
@@ -118,48 +185,34 @@ static void bts_calc_bw(void)
 
 #if IS_ENABLED(CONFIG_SOC_ZUMA)
 	for (i = 0; i < btsdev->num_nocl ; i++) {
-		nocl_total_rd_bw = 0;
-		nocl_total_wr_bw = 0;
-		btsdev->nocl_infos[i].peak_freq = 0;
-		list_for_each_entry(bw, &btsdev->nocl_infos[i].list, node) {
-			nocl_total_rd_bw += bw->read;
-			nocl_total_wr_bw += bw->write;
-			nocl_peak_freq = (bw->peak / bw->bus_width) * 100 / INT_UTIL;
-			if (btsdev->nocl_infos[i].peak_freq < nocl_peak_freq)
-				btsdev->nocl_infos[i].peak_freq = nocl_peak_freq;
-		}
-		if (!strcmp(btsdev->nocl_infos[i].nocl_name, "nocl2aa") ||
-		    !strcmp(btsdev->nocl_infos[i].nocl_name, "nocl2ab")) {
+		nocl = &btsdev->nocl_infos[i];
+		nocl->peak_freq = nocl->ip_peak_freq;
+		if (nocl->is_nocl2a) {
 			/* In Zuma, the equivalent of bus1 is NOCL2AA & NOCL2AB
 			 * so first calculate the required frequency for these
 			 * two nocls to get the bus1_freq.
 			 */
-			nocl_peak_freq = (nocl_total_rd_bw / INT_BUS_WIDTH) /
+			nocl_peak_freq = (nocl->total_rd_bw / INT_BUS_WIDTH) /
 				NOCL2A_NUM_CHANNEL * 100 / INT_UTIL;
-			btsdev->nocl_infos[i].peak_freq = max(nocl_peak_freq,
-				btsdev->nocl_infos[i].peak_freq);
-			nocl_peak_freq = (nocl_total_wr_bw / INT_BUS_WIDTH) /
+			nocl->peak_freq = max(nocl_peak_freq, nocl->peak_freq);
+			nocl_peak_freq = (nocl->total_wr_bw / INT_BUS_WIDTH) /
 				NOCL2A_NUM_CHANNEL * 100 / INT_UTIL;
-			btsdev->nocl_infos[i].peak_freq = max(nocl_peak_freq,
-				btsdev->nocl_infos[i].peak_freq);
-			bus1_freq = max(bus1_freq, btsdev->nocl_infos[i].peak_freq);
+			nocl->peak_freq = max(nocl_peak_freq, nocl->peak_freq);
+			bus1_freq = max(bus1_freq, nocl->peak_freq);
 		} else {
 			/* This block is to calculate the required frequency
 			 * of NOCL1A.
 			 */
 			nocl_peak_freq = (total_read / INT_BUS_WIDTH) /
 				NUM_CHANNEL * 100 / INT_UTIL;
-			btsdev->nocl_infos[i].peak_freq = max(nocl_peak_freq,
-				btsdev->nocl_infos[i].peak_freq);
+			nocl->peak_freq = max(nocl_peak_freq, nocl->peak_freq);
 			nocl_peak_freq = (total_write / INT_BUS_WIDTH) /
 				NUM_CHANNEL * 100 / INT_UTIL;
-			btsdev->nocl_infos[i].peak_freq = max(nocl_peak_freq,
-				btsdev->nocl_infos[i].peak_freq);
-			int_freq = btsdev->nocl_infos[i].peak_freq;
+			nocl->peak_freq = max(nocl_peak_freq, nocl->peak_freq);
+			int_freq = nocl->peak_freq;
 		}
 		ret += scnprintf(buf + ret, sizeof(buf) - ret, "%s:%.8u ",
-				 btsdev->nocl_infos[i].nocl_name,
-				 btsdev->nocl_infos[i].peak_freq);
+				 nocl->nocl_name, nocl->peak_freq);
 	}
 	BTSDBG_LOG(btsdev->dev, "Freq: %s\n", buf);
 
@@ -179,71 +232,109 @@ static void bts_calc_bw(void)
 		   btsdev->total_bw, total_read, total_write, btsdev->peak_bw, rt_bw,
 		   mif_freq, bus1_freq, int_freq);
 #endif
-	trace_clock_set_rate("BTS_mif_freq", mif_freq, raw_smp_processor_id());
-	trace_clock_set_rate("BTS_int_freq", int_freq, raw_smp_processor_id());
 
+	if (mif_freq != btsdev->mif_freq) {
+		trace_clock_set_rate("BTS_mif_freq", mif_freq, raw_smp_processor_id());
 #if IS_ENABLED(CONFIG_EXYNOS_PM_QOS)
-	exynos_pm_qos_update_request(&exynos_mif_qos, mif_freq);
-	exynos_pm_qos_update_request(&exynos_int_qos, int_freq);
+		exynos_pm_qos_update_request(&exynos_mif_qos, mif_freq);
 #else
-	pm_qos_update_request(&exynos_mif_qos, mif_freq);
-	pm_qos_update_request(&exynos_int_qos, int_freq);
+		pm_qos_update_request(&exynos_mif_qos, mif_freq);
 #endif
-	mutex_unlock(&btsdev->mutex_lock);
+		btsdev->mif_freq = mif_freq;
+	}
+
+	if (int_freq != btsdev->int_freq) {
+		trace_clock_set_rate("BTS_int_freq", int_freq, raw_smp_processor_id());
+#if IS_ENABLED(CONFIG_EXYNOS_PM_QOS)
+		exynos_pm_qos_update_request(&exynos_int_qos, int_freq);
+#else
+		pm_qos_update_request(&exynos_int_qos, int_freq);
+#endif
+		btsdev->int_freq = int_freq;
+	}
+}
+
+/*
+ * bw_trip[] is sorted in ascending order, so the bin is the first trip point
+ * above the bandwidth, or the last bin when none is.
+ */
+static int bts_get_hist_idx(unsigned int bw)
+{
+	int lo = 0, hi = BTS_HIST_BIN - 1, mid;
+
+	if (!bw)
+		return -1;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (bw < bw_trip[mid])
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return lo;
 }
 
 static void bts_update_stats(unsigned int index)
 {
-	struct bts_bw *bw = btsdev->bts_bw;
-	int i;
+	struct bts_bw_stats *stats = &btsdev->bts_bw[index].stats;
 	int total_prev_idx, peak_prev_idx;
 	int total_bin_idx, peak_bin_idx;
-	unsigned int total_bw, peak_bw;
 	u64 curr, duration;
 
-	total_bw = bw[index].read + bw[index].write;
-	peak_bw = bw[index].peak;
-
-	for (i = 0; i < BTS_HIST_BIN - 1; i++) {
-		if (total_bw < bw_trip[i])
-			break;
-	}
-	total_bin_idx = total_bw ? i : -1;
-
-	for (i = 0; i < BTS_HIST_BIN - 1; i++) {
-		if (peak_bw < bw_trip[i])
-			break;
-	}
-	peak_bin_idx = peak_bw ? i : -1;
+	total_bin_idx = bts_get_hist_idx(btsdev->bts_bw[index].read +
+					 btsdev->bts_bw[index].write);
+	peak_bin_idx = bts_get_hist_idx(btsdev->bts_bw[index].peak);
 
 	curr = ktime_get_ns();
-	if (!bw[index].stats.start_time) {
+	if (!stats->start_time) {
 		if (total_bin_idx < 0 && peak_bin_idx < 0)
 			return;
-		bw[index].stats.start_time = curr;
-		bw[index].stats.total.hist_idx = total_bin_idx;
-		bw[index].stats.peak.hist_idx = peak_bin_idx;
+		write_seqcount_begin(&btsdev->stats_seq[index]);
+		stats->start_time = curr;
+		stats->total.hist_idx = total_bin_idx;
+		stats->peak.hist_idx = peak_bin_idx;
+		write_seqcount_end(&btsdev->stats_seq[index]);
 		return;
 	}
 
-	total_prev_idx = bw[index].stats.total.hist_idx;
-	peak_prev_idx = bw[index].stats.peak.hist_idx;
-	bw[index].stats.total.hist_idx = total_bin_idx;
-	bw[index].stats.peak.hist_idx = peak_bin_idx;
-	duration = curr - bw[index].stats.start_time;
-	bw[index].stats.start_time = curr;
-	if (total_prev_idx < 0 && peak_prev_idx < 0)
-		return;
+	write_seqcount_begin(&btsdev->stats_seq[index]);
+	total_prev_idx = stats->total.hist_idx;
+	peak_prev_idx = stats->peak.hist_idx;
+	stats->total.hist_idx = total_bin_idx;
+	stats->peak.hist_idx = peak_bin_idx;
+	duration = curr - stats->start_time;
+	stats->start_time = curr;
 
 	if (total_prev_idx >= 0) {
-		bw[index].stats.total.count[total_prev_idx]++;
-		bw[index].stats.total.total_time[total_prev_idx] += duration;
+		stats->total.count[total_prev_idx]++;
+		stats->total.total_time[total_prev_idx] += duration;
 	}
 	if (peak_prev_idx >= 0) {
-		bw[index].stats.peak.count[peak_prev_idx]++;
-		bw[index].stats.peak.total_time[peak_prev_idx] += duration;
+		stats->peak.count[peak_prev_idx]++;
+		stats->peak.total_time[peak_prev_idx] += duration;
 	}
-	return;
+	write_seqcount_end(&btsdev->stats_seq[index]);
+}
+
+/*
+ * Take a consistent copy of the histogram of every registered client without
+ * blocking voters. Returns the number of clients copied.
+ */
+static unsigned int bts_snapshot_stats(struct bts_bw_stats *snap)
+{
+	unsigned int i, seq;
+
+	for (i = 0; (i < btsdev->num_bts) &&
+		(btsdev->bts_bw[i].name != NULL); i++) {
+		do {
+			seq = read_seqcount_begin(&btsdev->stats_seq[i]);
+			snap[i] = btsdev->bts_bw[i].stats;
+		} while (read_seqcount_retry(&btsdev->stats_seq[i], seq));
+	}
+
+	return i;
 }
 
 static void bts_set(unsigned int scen, unsigned int index)
@@ -333,6 +424,7 @@ int bts_get_bwindex(const char *name)
 				list_add(&bw[index].node, &btsdev->nocl_infos[i].list);
 				bw[index].bus_width =
 					btsdev->nocl_infos[i].nocl_ips[j].ip_bus_width;
+				btsdev->bw_nocl[index] = &btsdev->nocl_infos[i];
 			}
 		}
 	}
@@ -368,6 +460,7 @@ EXPORT_SYMBOL_GPL(bts_get_scenindex);
 int bts_update_bw(unsigned int index, struct bts_bw bw)
 {
 	struct bts_bw *bts_bw = btsdev->bts_bw;
+	struct bts_bw old;
 	unsigned int total_bw;
 	char trace_name[32];
 
@@ -386,12 +479,19 @@ int bts_update_bw(unsigned int index, struct bts_bw bw)
 		goto err;
 	}
 
+	mutex_lock(&btsdev->mutex_lock);
+
 	spin_lock(&btsdev->lock);
+	old.peak = bts_bw[index].peak;
+	old.read = bts_bw[index].read;
+	old.write = bts_bw[index].write;
+	old.rt = bts_bw[index].rt;
 	bts_bw[index].peak = bw.peak;
 	bts_bw[index].read = bw.read;
 	bts_bw[index].write = bw.write;
 	if (bts_bw[index].is_rt)
 		bts_bw[index].rt = bw.rt;
+	bts_account_bw(index, &old);
 	spin_unlock(&btsdev->lock);
 
 	if(trace_clock_set_rate_enabled()) {
@@ -412,6 +512,8 @@ int bts_update_bw(unsigned int index, struct bts_bw bw)
 	bts_calc_bw();
 	bts_update_stats(index);
 
+	mutex_unlock(&btsdev->mutex_lock);
+
 	return 0;
 
 err:
@@ -587,9 +689,15 @@ static int exynos_bts_bw_open(struct inode *inode, struct file *file)
 
 static int exynos_bts_bw_hist_open_show(struct seq_file *buf, void *d)
 {
+	struct bts_bw_stats *snap;
+	unsigned int num;
 	int i, j;
 
-	mutex_lock(&btsdev->mutex_lock);
+	snap = kmalloc_array(btsdev->num_bts, sizeof(*snap), GFP_KERNEL);
+	if (!snap)
+		return -ENOMEM;
+	num = bts_snapshot_stats(snap);
+
 	seq_printf(buf, "Total BW, Count:\nkB/s:\t");
 	for (i = 0; i < BTS_HIST_BIN - 1; i++) {
 		seq_printf(
@@ -598,8 +706,7 @@ static int exynos_bts_bw_hist_open_show(struct seq_file *buf, void *d)
 			bw_trip[i]);
 	}
 	seq_printf(buf, ">%u\n", bw_trip[i - 1]);
-	for (i = 0; (btsdev->bts_bw[i].name != NULL) &&
-		(i < btsdev->num_bts); i++) {
+	for (i = 0; i < num; i++) {
 		seq_printf(
 			buf,
 			"%s:\t",
@@ -608,7 +715,7 @@ static int exynos_bts_bw_hist_open_show(struct seq_file *buf, void *d)
 			seq_printf(
 				buf,
 				"%u\t",
-				btsdev->bts_bw[i].stats.total.count[j]);
+				snap[i].total.count[j]);
 		}
 		seq_printf(buf, "\n");
 	}
@@ -621,8 +728,7 @@ static int exynos_bts_bw_hist_open_show(struct seq_file *buf, void *d)
 	}
 	seq_printf(buf, ">%u\n", bw_trip[i - 1]);
 
-	for (i = 0; (btsdev->bts_bw[i].name != NULL) &&
-		(i < btsdev->num_bts); i++) {
+	for (i = 0; i < num; i++) {
 		seq_printf(
 			buf,
 			"%s:\t",
@@ -631,7 +737,7 @@ static int exynos_bts_bw_hist_open_show(struct seq_file *buf, void *d)
 			seq_printf(
 				buf,
 				"%llu\t",
-				btsdev->bts_bw[i].stats.total.total_time[j] /
+				snap[i].total.total_time[j] /
 				NSEC_PER_MSEC);
 		}
 		seq_printf(buf, "\n");
@@ -644,8 +750,7 @@ static int exynos_bts_bw_hist_open_show(struct seq_file *buf, void *d)
 			bw_trip[i]);
 	}
 	seq_printf(buf, ">%u\n", bw_trip[i - 1]);
-	for (i = 0; (btsdev->bts_bw[i].name != NULL) &&
-		(i < btsdev->num_bts); i++) {
+	for (i = 0; i < num; i++) {
 		seq_printf(
 			buf,
 			"%s:\t",
@@ -654,7 +759,7 @@ static int exynos_bts_bw_hist_open_show(struct seq_file *buf, void *d)
 			seq_printf(
 				buf,
 				"%u\t",
-				btsdev->bts_bw[i].stats.peak.count[j]);
+				snap[i].peak.count[j]);
 		}
 		seq_printf(buf, "\n");
 	}
@@ -667,8 +772,7 @@ static int exynos_bts_bw_hist_open_show(struct seq_file *buf, void *d)
 	}
 	seq_printf(buf, ">%u\n", bw_trip[i - 1]);
 
-	for (i = 0; (btsdev->bts_bw[i].name != NULL) &&
-		(i < btsdev->num_bts); i++) {
+	for (i = 0; i < num; i++) {
 		seq_printf(
 			buf,
 			"%s:\t",
@@ -677,12 +781,12 @@ static int exynos_bts_bw_hist_open_show(struct seq_file *buf, void *d)
 			seq_printf(
 				buf,
 				"%llu\t",
-				btsdev->bts_bw[i].stats.peak.total_time[j] /
+				snap[i].peak.total_time[j] /
 				NSEC_PER_MSEC);
 		}
 		seq_printf(buf, "\n");
 	}
-	mutex_unlock(&btsdev->mutex_lock);
+	kfree(snap);
 	return 0;
 }
 
@@ -694,10 +798,16 @@ static int exynos_bts_bw_hist_open(struct inode *inode, struct file *file)
 
 static ssize_t bts_stats_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
+	struct bts_bw_stats *snap;
+	unsigned int num;
 	int i, j;
 	ssize_t ret = 0;
 
-	mutex_lock(&btsdev->mutex_lock);
+	snap = kmalloc_array(btsdev->num_bts, sizeof(*snap), GFP_KERNEL);
+	if (!snap)
+		return -ENOMEM;
+	num = bts_snapshot_stats(snap);
+
 	ret += scnprintf(buf + ret, PAGE_SIZE - ret,
 			"Total BW, Time in ms:\nkB/s:\t");
 	for (i = 0; i < BTS_HIST_BIN - 1; i++) {
@@ -709,8 +819,7 @@ static ssize_t bts_stats_show(struct device *dev, struct device_attribute *attr,
 	}
 	ret += scnprintf(buf + ret, PAGE_SIZE - ret, ">%u\n", bw_trip[i - 1]);
 
-	for (i = 0; (btsdev->bts_bw[i].name != NULL) &&
-		(i < btsdev->num_bts); i++) {
+	for (i = 0; i < num; i++) {
 		ret += scnprintf(
 			buf + ret,
 			PAGE_SIZE - ret,
@@ -721,7 +830,7 @@ static ssize_t bts_stats_show(struct device *dev, struct device_attribute *attr,
 				buf + ret,
 				PAGE_SIZE - ret,
 				"%llu\t",
-				btsdev->bts_bw[i].stats.total.total_time[j] /
+				snap[i].total.total_time[j] /
 				NSEC_PER_MSEC);
 		}
 		ret += scnprintf(buf + ret, PAGE_SIZE - ret, "\n");
@@ -737,8 +846,7 @@ static ssize_t bts_stats_show(struct device *dev, struct device_attribute *attr,
 	}
 	ret += scnprintf(buf + ret, PAGE_SIZE - ret, ">%u\n", bw_trip[i - 1]);
 
-	for (i = 0; (btsdev->bts_bw[i].name != NULL) &&
-		(i < btsdev->num_bts); i++) {
+	for (i = 0; i < num; i++) {
 		ret += scnprintf(
 			buf + ret,
 			PAGE_SIZE - ret,
@@ -749,12 +857,12 @@ static ssize_t bts_stats_show(struct device *dev, struct device_attribute *attr,
 				buf + ret,
 				PAGE_SIZE - ret,
 				"%llu\t",
-				btsdev->bts_bw[i].stats.peak.total_time[j] /
+				snap[i].peak.total_time[j] /
 				NSEC_PER_MSEC);
 		}
 		ret += scnprintf(buf + ret, PAGE_SIZE - ret, "\n");
 	}
-	mutex_unlock(&btsdev->mutex_lock);
+	kfree(snap);
 	return ret;
 }
 
@@ -1715,6 +1823,9 @@ static int bts_parse_data(struct device_node *np, struct bts_device *data)
 			has_nocl2aa = true;
 		else if (!strcmp(data->nocl_infos[i].nocl_name, "nocl2ab"))
 			has_nocl2ab = true;
+		else
+			continue;
+		data->nocl_infos[i].is_nocl2a = true;
 	}
 	if (!has_nocl2aa || !has_nocl2ab) {
 		dev_err(data->dev,
@@ -1848,6 +1959,22 @@ static int bts_parse_data(struct device_node *np, struct bts_device *data)
 		goto err;
 	}
 
+	data->stats_seq = devm_kcalloc(data->dev, data->num_bts,
+				       sizeof(seqcount_mutex_t), GFP_KERNEL);
+	if (!data->stats_seq) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+#if IS_ENABLED(CONFIG_SOC_ZUMA)
+	data->bw_nocl = devm_kcalloc(data->dev, data->num_bts,
+				     sizeof(struct nocl_info *), GFP_KERNEL);
+	if (!data->bw_nocl) {
+		ret = -ENOMEM;
+		goto err;
+	}
+#endif
+
 	data->bts_list = info;
 	data->scen_list = scen;
 
@@ -1866,9 +1993,10 @@ ATTRIBUTE_GROUPS(bts_dev);
 
 static int bts_probe(struct platform_device *pdev)
 {
+	unsigned int i;
 	int ret;
 
-	btsdev = devm_kmalloc(&pdev->dev, sizeof(struct bts_device), GFP_KERNEL);
+	btsdev = devm_kzalloc(&pdev->dev, sizeof(struct bts_device), GFP_KERNEL);
 	if (!btsdev)
 		return -ENOMEM;
 
@@ -1889,6 +2017,8 @@ static int bts_probe(struct platform_device *pdev)
 	}
 	spin_lock_init(&btsdev->lock);
 	mutex_init(&btsdev->mutex_lock);
+	for (i = 0; i < btsdev->num_bts; i++)
+		seqcount_mutex_init(&btsdev->stats_seq[i], &btsdev->mutex_lock);
 	INIT_LIST_HEAD(&btsdev->scen_node);
 
 	ret = bts_initialize(btsdev);
@@ -25,6 +25,9 @@
 #include <linux/suspend.h>
 #include <linux/io.h>
 #include <linux/sched/clock.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
 #include <linux/clk.h>
 #include <linux/thermal.h>
 #include <soc/google/cal-if.h>
@@ -57,6 +60,13 @@
 
 static struct exynos_devfreq_data **devfreq_data;
 
+/*
+ * CAL switch latency histogram buckets, per destination level:
+ * < 16us, < 32us, ... < 1024us, >= 1024us.
+ */
+#define DEVFREQ_TRANS_LAT_BUCKETS	8
+#define DEVFREQ_TRANS_LAT_MIN_US	16
+
 static u32 freq_array[6];
 static u32 boot_array[2];
 
@@ -164,19 +174,34 @@ static int exynos_devfreq_get_cur_freq(struct device *dev,
 }
 
 /**
- * exynos_devfreq_get_freq_level() - Lookup freq_table for the frequency
- * @devfreq:	the devfreq instance
- * @freq:	the target frequency
+ * exynos_devfreq_find_idx() - Lookup opp_list for the frequency
+ * @data:	the exynos devfreq instance
+ * @freq:	the frequency to look up
+ *
+ * opp_list is ordered from the highest to the lowest frequency, which is
+ * checked once when the table is built; binary search it in that case.
+ * freq_table shares the same indexes.
  */
-static int exynos_devfreq_get_freq_level(struct devfreq *devfreq, unsigned long freq)
+static s32 exynos_devfreq_find_idx(struct exynos_devfreq_data *data,
+				   unsigned long freq)
 {
-	int lev;
+	int lo = 0, hi = (int)data->max_state - 1, mid;
 
-	for (lev = 0; lev < devfreq->profile->max_state; lev++)
-		if (freq == devfreq->profile->freq_table[lev])
-			return lev;
+	if (!data->opp_sorted)
+		return exynos_devfreq_get_opp_idx(data->opp_list,
+						  data->max_state, freq);
 
-	return -EINVAL;
+	while (lo <= hi) {
+		mid = lo + (hi - lo) / 2;
+		if (data->opp_list[mid].freq == freq)
+			return mid;
+		if (data->opp_list[mid].freq > freq)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+
+	return -ENODEV;
 }
 
 /**
@@ -187,18 +212,15 @@ static int exynos_devfreq_get_freq_level(struct devfreq *devfreq, unsigned long
 static int exynos_devfreq_update_status(struct exynos_devfreq_data *devdata)
 {
 	int prev_lev, ret = 0;
-	unsigned long cur_time;
-	struct devfreq *devfreq;
+	u64 cur_time;
 
-	devfreq = find_exynos_devfreq_device(devdata);
-
-	cur_time = jiffies;
+	cur_time = ktime_get_ns();
 
 	/* Immediately exit if previous_freq is not initialized yet. */
 	if (!devdata->previous_freq)
 		goto out;
 
-	prev_lev = exynos_devfreq_get_freq_level(devfreq, devdata->previous_freq);
+	prev_lev = exynos_devfreq_find_idx(devdata, devdata->previous_freq);
 	if (prev_lev < 0) {
 		ret = prev_lev;
 		goto out;
@@ -211,6 +233,23 @@ out:
 	return ret;
 }
 
+/* Account one CAL frequency switch into @idx's latency histogram */
+static void exynos_devfreq_account_trans(struct exynos_devfreq_data *data,
+					 s32 idx, u64 delta_ns)
+{
+	u64 us = div_u64(delta_ns, NSEC_PER_USEC);
+	int bucket = 0;
+
+	if (!data->trans_lat_hist)
+		return;
+
+	if (us >= DEVFREQ_TRANS_LAT_MIN_US)
+		bucket = min_t(int, ilog2(us) - ilog2(DEVFREQ_TRANS_LAT_MIN_US) + 1,
+			       DEVFREQ_TRANS_LAT_BUCKETS - 1);
+
+	data->trans_lat_hist[idx * DEVFREQ_TRANS_LAT_BUCKETS + bucket]++;
+}
+
 static int devfreq_frequency_scaler(int dm_type, void *devdata,
 				    u32 target_freq, unsigned int relation)
 {
@@ -948,20 +987,55 @@ static ssize_t time_in_state_show(struct device *dev,
 
 	mutex_lock(&data->lock);
 	err = exynos_devfreq_update_status(data);
-	if (err)
+	if (err) {
+		mutex_unlock(&data->lock);
 		return 0;
+	}
 
 	for (i = 0; i < max_state; i++) {
 		len += sprintf(buf + len, "%8lu",
 				devfreq->profile->freq_table[i]);
-		len += sprintf(buf + len, "%10u\n",
-			jiffies_to_msecs(data->time_in_state[i]));
+		len += sprintf(buf + len, "%10llu\n",
+			div_u64(data->time_in_state[i], NSEC_PER_MSEC));
 	}
 	mutex_unlock(&data->lock);
 	return len;
 }
 static DEVICE_ATTR_RO(time_in_state);
 
+static ssize_t trans_latency_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct platform_device *pdev = container_of(dev->parent, struct platform_device, dev);
+	struct exynos_devfreq_data *data = platform_get_drvdata(pdev);
+	ssize_t len = 0;
+	int i, j;
+
+	if (!data->trans_lat_hist)
+		return 0;
+
+	len += scnprintf(buf + len, PAGE_SIZE - len, "%8s", "to(KHz)");
+	for (j = 0; j < DEVFREQ_TRANS_LAT_BUCKETS - 1; j++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "  <%5uus",
+				 DEVFREQ_TRANS_LAT_MIN_US << j);
+	len += scnprintf(buf + len, PAGE_SIZE - len, " >=%5uus\n",
+			 DEVFREQ_TRANS_LAT_MIN_US << (j - 1));
+
+	mutex_lock(&data->lock);
+	for (i = 0; i < data->max_state; i++) {
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%8u",
+				 data->opp_list[i].freq);
+		for (j = 0; j < DEVFREQ_TRANS_LAT_BUCKETS; j++)
+			len += scnprintf(buf + len, PAGE_SIZE - len, " %9u",
+					 data->trans_lat_hist[i * DEVFREQ_TRANS_LAT_BUCKETS + j]);
+		len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+	}
+	mutex_unlock(&data->lock);
+
+	return len;
+}
+static DEVICE_ATTR_RO(trans_latency);
+
 static struct attribute *exynos_devfreq_sysfs_entries[] = {
 	&dev_attr_exynos_devfreq_info.attr,
 	&dev_attr_exynos_devfreq_get_freq.attr,
@@ -1925,6 +1999,15 @@ static int exynos_init_freq_table(struct exynos_devfreq_data *data)
 	int i, ret;
 	u32 freq, volt;
 
+	data->opp_sorted = true;
+	for (i = 1; i < data->max_state; i++) {
+		if (data->opp_list[i].freq >= data->opp_list[i - 1].freq) {
+			dev_warn(data->dev, "opp_list is not in descending order\n");
+			data->opp_sorted = false;
+			break;
+		}
+	}
+
 	for (i = 0; i < data->max_state; i++) {
 		freq = data->opp_list[i].freq;
 		volt = data->opp_list[i].volt;
@@ -2010,18 +2093,33 @@ static int exynos_devfreq_target(struct device *dev, unsigned long *target_freq,
 
 	before_target = sched_clock();
 
-	mutex_lock(&data->lock);
+	/*
+	 * opp_list and the enabled [min_freq, max_freq] range are fixed once
+	 * the device is registered, so an exact table entry inside that range
+	 * is what devfreq_recommended_opp() would return anyway. Only other
+	 * targets need the OPP framework, and neither needs data->lock.
+	 */
+	target_idx = exynos_devfreq_find_idx(data, *target_freq);
+	if (target_idx >= 0 && *target_freq >= data->min_freq &&
+	    *target_freq <= data->max_freq) {
+		target_volt = data->opp_list[target_idx].volt;
+	} else {
+		target_opp = devfreq_recommended_opp(dev, target_freq, flags);
+		if (IS_ERR(target_opp)) {
+			dev_err(dev, "not found valid OPP table\n");
+			ret = PTR_ERR(target_opp);
+			mutex_lock(&data->lock);
+			goto out;
+		}
 
-	target_opp = devfreq_recommended_opp(dev, target_freq, flags);
-	if (IS_ERR(target_opp)) {
-		dev_err(dev, "not found valid OPP table\n");
-		ret = PTR_ERR(target_opp);
-		goto out;
+		*target_freq = dev_pm_opp_get_freq(target_opp);
+		target_volt = (u32)dev_pm_opp_get_voltage(target_opp);
+		dev_pm_opp_put(target_opp);
+
+		target_idx = exynos_devfreq_find_idx(data, *target_freq);
 	}
 
-	*target_freq = dev_pm_opp_get_freq(target_opp);
-	target_volt = (u32)dev_pm_opp_get_voltage(target_opp);
-	dev_pm_opp_put(target_opp);
+	mutex_lock(&data->lock);
 
 	soft_max_freq = exynos_pm_qos_read_req_value(data->pm_qos_class_max,
 						     &data->pm_qos_soft_max_freq);
@@ -2030,8 +2128,6 @@ static int exynos_devfreq_target(struct device *dev, unsigned long *target_freq,
 		goto out;
 	}
 
-	target_idx = exynos_devfreq_get_opp_idx(data->opp_list, data->max_state,
-						*target_freq);
 	if (target_idx < 0) {
 		ret = -EINVAL;
 		goto out;
@@ -2061,6 +2157,8 @@ static int exynos_devfreq_target(struct device *dev, unsigned long *target_freq,
 	}
 
 	after_setfreq = sched_clock();
+	exynos_devfreq_account_trans(data, data->new_idx,
+				     after_setfreq - before_setfreq);
 #if IS_ENABLED(CONFIG_DEBUG_SNAPSHOT)
 	dbg_snapshot_freq(data->ess_flag, data->old_freq, data->new_freq,
 			  DSS_FLAG_OUT);
@@ -2392,7 +2490,7 @@ static int exynos_devfreq_probe(struct platform_device *pdev)
 
 	data->old_freq = (u32)data->devfreq_profile.initial_freq;
 	data->previous_freq = data->old_freq;
-	data->last_stat_updated = jiffies;
+	data->last_stat_updated = ktime_get_ns();
 	data->old_idx = exynos_devfreq_get_opp_idx(data->opp_list,
 						   data->max_state, data->old_freq);
 	if (data->old_idx < 0) {
@@ -2454,13 +2552,19 @@ static int exynos_devfreq_probe(struct platform_device *pdev)
 
 	data->time_in_state = devm_kcalloc(data->dev,
 					   data->devfreq->profile->max_state,
-					   sizeof(unsigned long),
+					   sizeof(*data->time_in_state),
 					   GFP_KERNEL);
 	if (!data->time_in_state) {
 		err = -ENOMEM;
 		goto err_devfreq;
 	}
 
+	/* Statistics only, the device works without them */
+	data->trans_lat_hist = devm_kcalloc(data->dev,
+					    data->max_state * DEVFREQ_TRANS_LAT_BUCKETS,
+					    sizeof(*data->trans_lat_hist),
+					    GFP_KERNEL);
+
 	lockdep_register_key(&data->devfreq_lock_key);
 	lockdep_set_class(&data->devfreq->lock, &data->devfreq_lock_key);
 
@@ -2566,6 +2670,12 @@ static int exynos_devfreq_probe(struct platform_device *pdev)
 		dev_warn(data->dev,
 			 "failed create sysfs for devfreq time_in_state\n");
 
+	ret = sysfs_create_file(&data->devfreq->dev.kobj,
+				&dev_attr_trans_latency.attr);
+	if (ret)
+		dev_warn(data->dev,
+			 "failed create sysfs for devfreq trans_latency\n");
+
 	ret = sysfs_create_file(&data->devfreq->dev.kobj,
 				&dev_attr_ppc_read_reset_disable.attr);
 	if (ret)
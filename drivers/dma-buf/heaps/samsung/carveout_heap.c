@@ -45,6 +45,10 @@ static struct dma_buf *carveout_heap_allocate(struct dma_heap *heap, unsigned lo
 
 	size = ALIGN(len, alignment);
 
+	dmabuf = samsung_secure_pool_export(samsung_dma_heap, size, fd_flags);
+	if (dmabuf)
+		return dmabuf;
+
 	buffer = samsung_dma_buffer_alloc(samsung_dma_heap, size, 1);
 	if (IS_ERR(buffer))
 		return ERR_PTR(-ENOMEM);
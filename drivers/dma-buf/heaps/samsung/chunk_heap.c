@@ -160,6 +160,10 @@ static struct dma_buf *chunk_heap_allocate(struct dma_heap *heap, unsigned long
 	size = ALIGN(len, chunk_size);
 	nr_chunks = size / chunk_size;
 
+	dmabuf = samsung_secure_pool_export(samsung_dma_heap, size, fd_flags);
+	if (dmabuf)
+		return dmabuf;
+
 	pages = kvmalloc_array(nr_chunks, sizeof(*pages), GFP_KERNEL);
 	if (!pages)
 		return ERR_PTR(-ENOMEM);
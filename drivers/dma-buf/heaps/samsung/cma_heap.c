@@ -18,14 +18,205 @@
 #include <linux/of_reserved_mem.h>
 #include <linux/platform_device.h>
 #include <linux/scatterlist.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #include "samsung-dma-heap.h"
 
+/* Buffers are cleaned in slices of at least this size, one per worker */
+#define CMA_HEAP_CLEAN_SLICE_MIN	SZ_8M
+#define CMA_HEAP_CLEAN_MAX_WORKERS	4
+/* An unused reservation is given back to CMA after this long */
+#define CMA_HEAP_RESERVE_TIMEOUT_MS	10000
+
 struct cma_heap {
 	struct cma *cma;
+	unsigned int align_order;
+	/*
+	 * Pages allocated and zeroed ahead of time on request through the
+	 * reserve_kb attribute, handed to the next allocation that fits.
+	 * Released again if nothing takes it within the timeout, or if an
+	 * allocation from CMA fails while it is held.
+	 */
+	struct mutex reserve_lock; /* protects reserve_pages and reserve_nr_pages */
+	struct page *reserve_pages;
+	unsigned long reserve_nr_pages;
+	unsigned long reserve_req_pages;
+	struct work_struct reserve_work;
+	struct delayed_work reserve_expire_work;
 };
 
+struct cma_heap_clean_work {
+	struct work_struct work;
+	struct device *dev;
+	struct page *pages;
+	unsigned long size;
+	bool clean;
+	bool flush;
+};
+
+static void cma_heap_clean_range(struct cma_heap_clean_work *cw)
+{
+	dma_addr_t dma;
+
+	if (cw->clean)
+		heap_page_clean(cw->pages, cw->size);
+
+	if (!cw->flush)
+		return;
+
+	/* the same cache maintenance as heap_cache_flush() for this slice */
+	dma = dma_map_page(cw->dev, cw->pages, 0, cw->size, DMA_TO_DEVICE);
+	if (!dma_mapping_error(cw->dev, dma))
+		dma_unmap_page(cw->dev, dma, cw->size, DMA_TO_DEVICE);
+}
+
+static void cma_heap_clean_work_fn(struct work_struct *work)
+{
+	cma_heap_clean_range(container_of(work, struct cma_heap_clean_work, work));
+}
+
+/*
+ * Zero and/or flush physically contiguous pages. Large buffers are split
+ * into slices handled by unbound workers in parallel with the caller.
+ */
+static void cma_heap_clean_pages(struct device *dev, struct page *pages,
+				 unsigned long size, bool clean, bool flush)
+{
+	struct cma_heap_clean_work cw[CMA_HEAP_CLEAN_MAX_WORKERS];
+	unsigned long slice, offset = 0;
+	int i, nr;
+
+	if (!clean && !flush)
+		return;
+
+	nr = min_t(unsigned long, size / CMA_HEAP_CLEAN_SLICE_MIN,
+		   min_t(int, num_online_cpus(), CMA_HEAP_CLEAN_MAX_WORKERS));
+	nr = max(nr, 1);
+	slice = PAGE_ALIGN(DIV_ROUND_UP(size, nr));
+
+	for (i = 0; i < nr && offset < size; i++) {
+		cw[i].dev = dev;
+		cw[i].pages = nth_page(pages, offset >> PAGE_SHIFT);
+		cw[i].size = min(slice, size - offset);
+		cw[i].clean = clean;
+		cw[i].flush = flush;
+		offset += cw[i].size;
+
+		if (i) {
+			INIT_WORK_ONSTACK(&cw[i].work, cma_heap_clean_work_fn);
+			queue_work(system_unbound_wq, &cw[i].work);
+		}
+	}
+	nr = i;
+
+	cma_heap_clean_range(&cw[0]);
+
+	for (i = 1; i < nr; i++) {
+		flush_work(&cw[i].work);
+		destroy_work_on_stack(&cw[i].work);
+	}
+}
+
+static void cma_heap_reserve_drop_locked(struct cma_heap *cma_heap)
+{
+	if (!cma_heap->reserve_nr_pages)
+		return;
+
+	cma_release(cma_heap->cma, cma_heap->reserve_pages, cma_heap->reserve_nr_pages);
+	cma_heap->reserve_pages = NULL;
+	cma_heap->reserve_nr_pages = 0;
+}
+
+/* Drop the reservation and the request for it, returns true if one was held */
+static bool cma_heap_reserve_release(struct cma_heap *cma_heap)
+{
+	bool dropped;
+
+	mutex_lock(&cma_heap->reserve_lock);
+	dropped = !!cma_heap->reserve_nr_pages;
+	cma_heap_reserve_drop_locked(cma_heap);
+	WRITE_ONCE(cma_heap->reserve_req_pages, 0);
+	mutex_unlock(&cma_heap->reserve_lock);
+
+	return dropped;
+}
+
+static void cma_heap_reserve_expire_work(struct work_struct *work)
+{
+	struct cma_heap *cma_heap = container_of(to_delayed_work(work), struct cma_heap,
+						 reserve_expire_work);
+
+	cma_heap_reserve_release(cma_heap);
+}
+
+static void cma_heap_reserve_work(struct work_struct *work)
+{
+	struct cma_heap *cma_heap = container_of(work, struct cma_heap, reserve_work);
+	unsigned long nr_pages;
+	struct page *pages;
+
+	/* allocations skip the reservation while it is being refilled */
+	mutex_lock(&cma_heap->reserve_lock);
+	nr_pages = READ_ONCE(cma_heap->reserve_req_pages);
+	if (cma_heap->reserve_nr_pages == nr_pages)
+		goto out;
+
+	cma_heap_reserve_drop_locked(cma_heap);
+	if (!nr_pages)
+		goto out;
+
+	pages = cma_alloc(cma_heap->cma, nr_pages, cma_heap->align_order, true);
+	if (!pages) {
+		pr_err("%s: failed to reserve %lu pages\n", __func__, nr_pages);
+		goto out;
+	}
+
+	cma_heap_clean_pages(NULL, pages, nr_pages << PAGE_SHIFT, true, false);
+	cma_heap->reserve_pages = pages;
+	cma_heap->reserve_nr_pages = nr_pages;
+	mod_delayed_work(system_unbound_wq, &cma_heap->reserve_expire_work,
+			 msecs_to_jiffies(CMA_HEAP_RESERVE_TIMEOUT_MS));
+out:
+	mutex_unlock(&cma_heap->reserve_lock);
+}
+
+/*
+ * Take the reservation for an allocation it fits: aligned as requested and
+ * no more than twice its size, giving the excess back to CMA. A reservation
+ * is used by one allocation only. Any other allocation leaves it alone, and
+ * so does one racing with the refill, which goes to cma_alloc() instead of
+ * waiting for it.
+ */
+static struct page *cma_heap_take_reserved(struct cma_heap *cma_heap,
+					   unsigned long nr_pages,
+					   unsigned int alignment)
+{
+	struct page *pages = NULL;
+
+	if (!READ_ONCE(cma_heap->reserve_req_pages))
+		return NULL;
+
+	if (!mutex_trylock(&cma_heap->reserve_lock))
+		return NULL;
+
+	if (cma_heap->reserve_nr_pages >= nr_pages &&
+	    cma_heap->reserve_nr_pages / 2 < nr_pages &&
+	    IS_ALIGNED(page_to_phys(cma_heap->reserve_pages), alignment)) {
+		pages = cma_heap->reserve_pages;
+		if (cma_heap->reserve_nr_pages > nr_pages)
+			cma_release(cma_heap->cma, nth_page(pages, nr_pages),
+				    cma_heap->reserve_nr_pages - nr_pages);
+		cma_heap->reserve_pages = NULL;
+		cma_heap->reserve_nr_pages = 0;
+		WRITE_ONCE(cma_heap->reserve_req_pages, 0);
+	}
+	mutex_unlock(&cma_heap->reserve_lock);
+
+	return pages;
+}
+
 static struct dma_buf *cma_heap_allocate(struct dma_heap *heap, unsigned long len,
 					 unsigned long fd_flags, unsigned long heap_flags)
 {
@@ -36,6 +227,7 @@ static struct dma_buf *cma_heap_allocate(struct dma_heap *heap, unsigned long le
 	struct page *pages;
 	unsigned int alignment = samsung_dma_heap->alignment;
 	unsigned long size, nr_pages;
+	bool reserved = false;
 	int protret = 0, ret = -ENOMEM;
 
 	if (dma_heap_flags_video_aligned(samsung_dma_heap->flags))
@@ -44,11 +236,22 @@ static struct dma_buf *cma_heap_allocate(struct dma_heap *heap, unsigned long le
 	size = ALIGN(len, alignment);
 	nr_pages = size >> PAGE_SHIFT;
 
+	dmabuf = samsung_secure_pool_export(samsung_dma_heap, size, fd_flags);
+	if (dmabuf)
+		return dmabuf;
+
 	buffer = samsung_dma_buffer_alloc(samsung_dma_heap, size, 1);
 	if (IS_ERR(buffer))
 		return ERR_PTR(-ENOMEM);
 
-	pages = cma_alloc(cma_heap->cma, nr_pages, get_order(alignment), false);
+	pages = cma_heap_take_reserved(cma_heap, nr_pages, alignment);
+	if (pages)
+		reserved = true;
+	else
+		pages = cma_alloc(cma_heap->cma, nr_pages, get_order(alignment), false);
+	/* the reservation may be what keeps this allocation from fitting */
+	if (!pages && cma_heap_reserve_release(cma_heap))
+		pages = cma_alloc(cma_heap->cma, nr_pages, get_order(alignment), false);
 	if (!pages) {
 		perrfn("failed to allocate from %s, size %lu", dma_heap_get_name(heap), size);
 		goto free_cma;
@@ -56,8 +259,9 @@ static struct dma_buf *cma_heap_allocate(struct dma_heap *heap, unsigned long le
 
 	dma_heap_inc_inuse(nr_pages);
 	sg_set_page(buffer->sg_table.sgl, pages, size, 0);
-	heap_page_clean(pages, size);
-	heap_cache_flush(buffer);
+	/* reserved pages are zeroed already */
+	cma_heap_clean_pages(dma_heap_get_dev(heap), pages, size, !reserved,
+			     dma_heap_skip_cache_ops(buffer->flags));
 
 	if (dma_heap_flags_protected(samsung_dma_heap->flags)) {
 		buffer->priv = samsung_dma_buffer_protect(buffer, size, 1,
@@ -116,9 +320,52 @@ static const struct dma_heap_ops cma_heap_ops = {
 	.allocate = cma_heap_allocate,
 };
 
+static ssize_t reserve_kb_show(struct device *dev, struct device_attribute *attr,
+			       char *buf)
+{
+	struct cma_heap *cma_heap = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%lu\n",
+			  READ_ONCE(cma_heap->reserve_nr_pages) << (PAGE_SHIFT - 10));
+}
+
+/*
+ * Writing a size asks for that much to be allocated and zeroed in the
+ * background for the next allocation; writing 0 drops the reservation.
+ * The reservation is dropped by itself after CMA_HEAP_RESERVE_TIMEOUT_MS
+ * if no allocation takes it.
+ */
+static ssize_t reserve_kb_store(struct device *dev, struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct cma_heap *cma_heap = dev_get_drvdata(dev);
+	unsigned long kb;
+
+	if (kstrtoul(buf, 0, &kb))
+		return -EINVAL;
+
+	if (kb > cma_get_size(cma_heap->cma) / SZ_1K)
+		return -EINVAL;
+
+	/* the refill rearms the timeout for the new reservation */
+	cancel_delayed_work(&cma_heap->reserve_expire_work);
+	WRITE_ONCE(cma_heap->reserve_req_pages, DIV_ROUND_UP(kb, PAGE_SIZE / SZ_1K));
+	queue_work(system_unbound_wq, &cma_heap->reserve_work);
+
+	return count;
+}
+static DEVICE_ATTR_RW(reserve_kb);
+
+static struct attribute *cma_heap_attrs[] = {
+	&dev_attr_reserve_kb.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(cma_heap);
+
 static int cma_heap_probe(struct platform_device *pdev)
 {
 	struct cma_heap *cma_heap;
+	unsigned int alignment = PAGE_SIZE;
 	int ret;
 
 	ret = of_reserved_mem_device_init(&pdev->dev);
@@ -138,6 +385,14 @@ static int cma_heap_probe(struct platform_device *pdev)
 		return -ENOMEM;
 	cma_heap->cma = pdev->dev.cma_area;
 
+	/* same alignment as samsung_heap_add() gives the heaps */
+	of_property_read_u32(pdev->dev.of_node, "dma-heap,alignment", &alignment);
+	cma_heap->align_order = min_t(unsigned int, get_order(alignment), MAX_ORDER);
+	mutex_init(&cma_heap->reserve_lock);
+	INIT_WORK(&cma_heap->reserve_work, cma_heap_reserve_work);
+	INIT_DELAYED_WORK(&cma_heap->reserve_expire_work, cma_heap_reserve_expire_work);
+	platform_set_drvdata(pdev, cma_heap);
+
 	ret = samsung_heap_add(&pdev->dev, cma_heap, cma_heap_release, &cma_heap_ops);
 
 	if (ret == -ENODEV)
@@ -156,6 +411,7 @@ static struct platform_driver cma_heap_driver = {
 	.driver		= {
 		.name	= "samsung,dma-heap-cma",
 		.of_match_table = cma_heap_of_match,
+		.dev_groups = cma_heap_groups,
 	},
 	.probe		= cma_heap_probe,
 };
@@ -18,6 +18,7 @@
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/pfn.h>
+#include <linux/workqueue.h>
 #include <soc/google/gcma.h>
 
 #include "samsung-dma-heap.h"
@@ -61,7 +62,7 @@ static inline bool page_is_gcma(struct page *page)
 	return page_private(page) ? true : false;
 }
 
-struct page *gcma_alloc(struct gcma_heap *gcma_heap, unsigned long size)
+static struct page *__gcma_alloc(struct gcma_heap *gcma_heap, unsigned long size)
 {
 	struct gen_pool *pool = gcma_heap->pool;
 	phys_addr_t paddr;
@@ -76,7 +77,6 @@ struct page *gcma_alloc(struct gcma_heap *gcma_heap, unsigned long size)
 	page = phys_to_page(paddr);
 	gcma_alloc_range(pfn, pfn + (size >> PAGE_SHIFT) - 1);
 	gcma_set_size(page, size);
-	inc_gcma_heap_stat(gcma_heap, USAGE, size);
 	/*
 	 * zero out pages to align with the strategy in buddy allocator GFP flag
 	 */
@@ -86,6 +86,99 @@ struct page *gcma_alloc(struct gcma_heap *gcma_heap, unsigned long size)
 	return page;
 }
 
+static struct page *gcma_reserve_get(struct gcma_heap *gcma_heap)
+{
+	struct page *page;
+	bool refill;
+
+	spin_lock(&gcma_heap->reserve_lock);
+	page = list_first_entry_or_null(&gcma_heap->reserve, struct page, lru);
+	if (page) {
+		list_del(&page->lru);
+		gcma_heap->reserve_count--;
+	}
+	refill = gcma_heap->reserve_count < gcma_heap->reserve_low;
+	spin_unlock(&gcma_heap->reserve_lock);
+
+	if (refill)
+		queue_work(system_unbound_wq, &gcma_heap->reserve_work);
+
+	return page;
+}
+
+/*
+ * Bring the reserve back to reserve_high: evict and zero new chunks, or give
+ * surplus chunks back to cleancache if the watermark was lowered.
+ */
+static void gcma_reserve_work(struct work_struct *work)
+{
+	struct gcma_heap *gcma_heap = container_of(work, struct gcma_heap,
+						   reserve_work);
+	struct page *page;
+
+	for (;;) {
+		unsigned long count, high;
+
+		spin_lock(&gcma_heap->reserve_lock);
+		count = gcma_heap->reserve_count;
+		high = gcma_heap->reserve_high;
+		page = NULL;
+		if (count > high) {
+			page = list_first_entry(&gcma_heap->reserve, struct page, lru);
+			list_del(&page->lru);
+			gcma_heap->reserve_count--;
+		}
+		spin_unlock(&gcma_heap->reserve_lock);
+
+		if (page) {
+			gcma_free(gcma_heap->pool, page);
+		} else if (count < high) {
+			page = __gcma_alloc(gcma_heap, GCMA_RESERVE_CHUNK_SIZE);
+			if (!page)
+				break;
+
+			spin_lock(&gcma_heap->reserve_lock);
+			list_add_tail(&page->lru, &gcma_heap->reserve);
+			gcma_heap->reserve_count++;
+			spin_unlock(&gcma_heap->reserve_lock);
+		} else {
+			break;
+		}
+
+		cond_resched();
+	}
+}
+
+void gcma_heap_set_reserve(struct gcma_heap *gcma_heap, unsigned long low,
+			   unsigned long high)
+{
+	spin_lock(&gcma_heap->reserve_lock);
+	gcma_heap->reserve_low = low;
+	gcma_heap->reserve_high = high;
+	spin_unlock(&gcma_heap->reserve_lock);
+
+	queue_work(system_unbound_wq, &gcma_heap->reserve_work);
+}
+
+struct page *gcma_alloc(struct gcma_heap *gcma_heap, unsigned long size)
+{
+	struct page *page = NULL;
+
+	if (size == GCMA_RESERVE_CHUNK_SIZE) {
+		page = gcma_reserve_get(gcma_heap);
+		if (page)
+			inc_gcma_heap_stat(gcma_heap, RESERVE_HIT, size);
+	}
+
+	if (!page)
+		page = __gcma_alloc(gcma_heap, size);
+
+	if (page)
+		inc_gcma_heap_stat(gcma_heap, USAGE, size);
+
+	return page;
+}
+
 void gcma_free(struct gen_pool *pool, struct page *page)
 {
 	unsigned long size, pfn;
@@ -239,6 +332,10 @@ static struct dma_buf *gcma_heap_allocate(struct dma_heap *heap, unsigned long l
 	INIT_LIST_HEAD(&heap_pages.pages_list);
 	len = ALIGN(len, alignment);
 
+	dmabuf = samsung_secure_pool_export(samsung_dma_heap, len, fd_flags);
+	if (dmabuf)
+		return dmabuf;
+
 	if (flexible_alloc) {
 		ret = allocate_flexible_pages(gcma_heap, len, &heap_pages);
 	} else {
@@ -369,6 +466,10 @@ static int gcma_heap_probe(struct platform_device *pdev)
 	gcma_heap->flexible_alloc =
 		of_property_read_bool(pdev->dev.of_node,"dma-heap-gcam,fleixble-alloc");
 
+	spin_lock_init(&gcma_heap->reserve_lock);
+	INIT_LIST_HEAD(&gcma_heap->reserve);
+	INIT_WORK(&gcma_heap->reserve_work, gcma_reserve_work);
+
 	is_secure_heap = of_property_read_bool(pdev->dev.of_node,"dma-heap,secure");
 
 	if (is_secure_heap && gcma_heap->flexible_alloc) {
@@ -7,16 +7,37 @@
 #ifndef __GCMA_HEAP_H
 #define __GCMA_HEAP_H
 
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+/* Size of the pre-evicted chunks kept in the reserve */
+#define GCMA_RESERVE_CHUNK_SIZE (PAGE_SIZE << 4)
+
 struct gcma_heap {
         struct gen_pool *pool;
 #ifdef CONFIG_SYSFS
         struct gcma_heap_stat *stat;
 #endif
         bool flexible_alloc;
+        /*
+         * Chunks already evicted from cleancache and zeroed, handed out
+         * before falling back to evicting in the allocation path. Refilled
+         * in the background whenever it drops below reserve_low, up to
+         * reserve_high. Both are in chunks; 0 disables the reserve.
+         */
+        spinlock_t reserve_lock; /* protects reserve and reserve_count */
+        struct list_head reserve;
+        unsigned long reserve_count;
+        unsigned long reserve_low;
+        unsigned long reserve_high;
+        struct work_struct reserve_work;
 };
 
 
 struct page *gcma_alloc(struct gcma_heap *gcma_heap, unsigned long size);
 void gcma_free(struct gen_pool *pool, struct page *page);
+void gcma_heap_set_reserve(struct gcma_heap *gcma_heap, unsigned long low,
+                           unsigned long high);
 
 #endif
@@ -27,6 +27,7 @@ struct gcma_heap_stat {
 	unsigned long max_usage_bytes;
 	unsigned long cur_usage_bytes;
 	unsigned long allocstall_bytes;
+	unsigned long reserve_hit_bytes;
 	struct kobject kobj;
 	struct gcma_heap *heap;
 	char name[PATH_MAX];
@@ -46,6 +47,8 @@ void inc_gcma_heap_stat(struct gcma_heap *heap, enum stat_type type,
 			 stat->max_usage_bytes = stat->cur_usage_bytes;
 	} else if (type == ALLOCSTALL) {
 		stat->allocstall_bytes += size;
+	} else if (type == RESERVE_HIT) {
+		stat->reserve_hit_bytes += size;
 	}
 	spin_unlock(&stat->lock);
 }
@@ -62,6 +65,8 @@ void dec_gcma_heap_stat(struct gcma_heap *heap, enum stat_type type,
 		stat->cur_usage_bytes -= size;
 	else if (type == ALLOCSTALL)
 		stat->allocstall_bytes -= size;
+	else if (type == RESERVE_HIT)
+		stat->reserve_hit_bytes -= size;
 	spin_unlock(&stat->lock);
 }
 
@@ -136,6 +141,114 @@ static ssize_t alloc_stall_kb_show(struct kobject *kobj,
 }
 GCMA_HEAP_ATTR_RW(alloc_stall_kb);
 
+static ssize_t reserve_hit_kb_store(struct kobject *kobj,
+                                   struct kobj_attribute *attr,
+                                   const char *buf, size_t count)
+{
+	struct gcma_heap_stat *stat = to_gcma_heap_stat(kobj);
+
+	spin_lock(&stat->lock);
+	stat->reserve_hit_bytes = 0;
+	spin_unlock(&stat->lock);
+
+	return count;
+}
+
+static ssize_t reserve_hit_kb_show(struct kobject *kobj,
+                                  struct kobj_attribute *attr,
+                                  char *buf)
+{
+	struct gcma_heap_stat *stat = to_gcma_heap_stat(kobj);
+	unsigned long reserve_hit_bytes;
+
+	spin_lock(&stat->lock);
+	reserve_hit_bytes = stat->reserve_hit_bytes;
+	spin_unlock(&stat->lock);
+
+	return sysfs_emit(buf, "%lu\n", reserve_hit_bytes / 1024);
+}
+GCMA_HEAP_ATTR_RW(reserve_hit_kb);
+
+static ssize_t reserve_kb_show(struct kobject *kobj,
+                               struct kobj_attribute *attr,
+                               char *buf)
+{
+	struct gcma_heap *gcma_heap = to_gcma_heap_stat(kobj)->heap;
+	unsigned long reserve_count;
+
+	spin_lock(&gcma_heap->reserve_lock);
+	reserve_count = gcma_heap->reserve_count;
+	spin_unlock(&gcma_heap->reserve_lock);
+
+	return sysfs_emit(buf, "%lu\n",
+			  reserve_count * GCMA_RESERVE_CHUNK_SIZE / 1024);
+}
+GCMA_HEAP_ATTR_RO(reserve_kb);
+
+/*
+ * reserve_low_kb/reserve_high_kb are rounded up to whole reserve chunks and
+ * low must not exceed high; raise high first, lower low first.
+ */
+static ssize_t reserve_wmark_store(struct kobject *kobj, const char *buf,
+                                   size_t len, bool is_high)
+{
+	struct gcma_heap *gcma_heap = to_gcma_heap_stat(kobj)->heap;
+	unsigned long kb, chunks, low, high;
+
+	if (kstrtoul(buf, 0, &kb))
+		return -EINVAL;
+
+	chunks = DIV_ROUND_UP(kb * 1024, GCMA_RESERVE_CHUNK_SIZE);
+
+	spin_lock(&gcma_heap->reserve_lock);
+	low = is_high ? gcma_heap->reserve_low : chunks;
+	high = is_high ? chunks : gcma_heap->reserve_high;
+	spin_unlock(&gcma_heap->reserve_lock);
+
+	if (low > high)
+		return -EINVAL;
+
+	gcma_heap_set_reserve(gcma_heap, low, high);
+
+	return len;
+}
+
+static ssize_t reserve_low_kb_store(struct kobject *kobj,
+                                    struct kobj_attribute *attr,
+                                    const char *buf, size_t len)
+{
+	return reserve_wmark_store(kobj, buf, len, false);
+}
+
+static ssize_t reserve_low_kb_show(struct kobject *kobj,
+                                   struct kobj_attribute *attr,
+                                   char *buf)
+{
+	struct gcma_heap *gcma_heap = to_gcma_heap_stat(kobj)->heap;
+
+	return sysfs_emit(buf, "%lu\n",
+			  READ_ONCE(gcma_heap->reserve_low) * GCMA_RESERVE_CHUNK_SIZE / 1024);
+}
+GCMA_HEAP_ATTR_RW(reserve_low_kb);
+
+static ssize_t reserve_high_kb_store(struct kobject *kobj,
+                                     struct kobj_attribute *attr,
+                                     const char *buf, size_t len)
+{
+	return reserve_wmark_store(kobj, buf, len, true);
+}
+
+static ssize_t reserve_high_kb_show(struct kobject *kobj,
+                                    struct kobj_attribute *attr,
+                                    char *buf)
+{
+	struct gcma_heap *gcma_heap = to_gcma_heap_stat(kobj)->heap;
+
+	return sysfs_emit(buf, "%lu\n",
+			  READ_ONCE(gcma_heap->reserve_high) * GCMA_RESERVE_CHUNK_SIZE / 1024);
+}
+GCMA_HEAP_ATTR_RW(reserve_high_kb);
+
 static ssize_t force_empty_store(struct kobject *kobj,
 				struct kobj_attribute *attr,
 				const char *buf, size_t len)
@@ -165,6 +278,10 @@ static struct attribute *gcma_heap_attrs[] = {
 	&cur_usage_kb_attr.attr,
 	&max_usage_kb_attr.attr,
 	&alloc_stall_kb_attr.attr,
+	&reserve_hit_kb_attr.attr,
+	&reserve_kb_attr.attr,
+	&reserve_low_kb_attr.attr,
+	&reserve_high_kb_attr.attr,
 	&force_empty_attr.attr,
 	NULL,
 };
@@ -10,6 +10,7 @@
 enum stat_type {
 	USAGE,
 	ALLOCSTALL,
+	RESERVE_HIT,
 };
 
 struct gcma_heap_stat;
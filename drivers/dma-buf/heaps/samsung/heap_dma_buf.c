@@ -456,6 +456,8 @@ static void samsung_heap_dma_buf_release(struct dma_buf *dmabuf)
 	dma_iova_release(dmabuf);
 
 	samsung_track_buffer_destroyed(buffer);
+	if (samsung_secure_pool_put(buffer))
+		return;
 	buffer->heap->release(buffer);
 }
 
@@ -54,6 +54,10 @@ struct samsung_dma_buffer {
 	struct deferred_freelist_item deferred_free;
 	unsigned long ino;
 	trusty_shared_mem_id_t mem_id;
+	/* entry in heap->secure_pool while parked for reuse */
+	struct list_head pool;
+	/* process that allocated the protected content, see secure_buffer.c */
+	struct pid *owner;
 };
 
 struct samsung_dma_heap {
@@ -65,6 +69,15 @@ struct samsung_dma_heap {
 	unsigned int alignment;
 	unsigned int protection_id;
 	struct device *trusty_dev;
+	/*
+	 * Released static-protected buffers kept lent to the secure world so
+	 * that an allocation of the same size can skip the Trusty round trips.
+	 */
+	spinlock_t secure_pool_lock; /* protects secure_pool and secure_pool_size */
+	struct list_head secure_pool;
+	unsigned long secure_pool_size;
+	unsigned long secure_pool_max; /* in bytes, 0 disables the pool */
+	struct list_head secure_pool_node; /* entry in the list of pooling heaps */
 };
 
 extern const struct dma_buf_ops samsung_dma_buf_ops;
@@ -157,6 +170,11 @@ void *samsung_dma_buffer_protect(struct samsung_dma_buffer *buffer,
 				 unsigned int chunk_size, unsigned int nr_pages,
 				 unsigned long paddr);
 int samsung_dma_buffer_unprotect(struct samsung_dma_buffer *buffer);
+int samsung_secure_pool_init(struct device *dev, struct samsung_dma_heap *heap,
+			     unsigned long max_size);
+struct dma_buf *samsung_secure_pool_export(struct samsung_dma_heap *heap,
+					   unsigned long size, unsigned long fd_flags);
+bool samsung_secure_pool_put(struct samsung_dma_buffer *buffer);
 #else
 static inline void *samsung_dma_buffer_protect(struct samsung_dma_buffer *buffer,
 					       unsigned int chunk_size,
@@ -170,6 +188,25 @@ static inline int samsung_dma_buffer_unprotect(struct samsung_dma_buffer *buffer
 {
 	return 0;
 }
+
+static inline int samsung_secure_pool_init(struct device *dev,
+					   struct samsung_dma_heap *heap,
+					   unsigned long max_size)
+{
+	return 0;
+}
+
+static inline struct dma_buf *samsung_secure_pool_export(struct samsung_dma_heap *heap,
+							 unsigned long size,
+							 unsigned long fd_flags)
+{
+	return NULL;
+}
+
+static inline bool samsung_secure_pool_put(struct samsung_dma_buffer *buffer)
+{
+	return false;
+}
 #endif
 
 #if defined(CONFIG_DMABUF_HEAPS_SAMSUNG_SYSTEM)
@@ -141,6 +141,8 @@ static struct samsung_dma_heap *__samsung_heap_add(struct device *dev, void *pri
 {
 	struct samsung_dma_heap *heap;
 	unsigned int alignment = PAGE_SIZE, order, protid = 0;
+	u32 pool_size = 0;
+	int ret;
 	struct dma_heap_export_info exp_info;
 	const char *name;
 	char *heap_name;
@@ -187,7 +189,11 @@ static struct samsung_dma_heap *__samsung_heap_add(struct device *dev, void *pri
 			return ERR_PTR(-EINVAL);
 		}
 		heap->trusty_dev = dev->parent;
+		of_property_read_u32(dev->of_node, "dma-heap,secure-pool-size", &pool_size);
 	}
+	ret = samsung_secure_pool_init(dev, heap, pool_size);
+	if (ret)
+		return ERR_PTR(ret);
 
 	exp_info.name = heap_name;
 	exp_info.ops = ops;
@@ -7,7 +7,9 @@
  */
 
 #include <linux/slab.h>
+#include <linux/sched.h>
 #include <linux/genalloc.h>
+#include <linux/shrinker.h>
 #include <linux/kmemleak.h>
 #include <linux/dma-mapping.h>
 #include <linux/dma-direct.h>
@@ -114,28 +116,39 @@ void *samsung_dma_buffer_protect(struct samsung_dma_buffer *buffer,
 		return ERR_PTR(ret);
 	}
 
+	buffer->owner = get_pid(task_tgid(current));
+
 	return protdesc;
 }
 
-int samsung_dma_buffer_unprotect(struct samsung_dma_buffer *buffer)
+static void buffer_prot_info_free(struct samsung_dma_buffer *buffer, bool free_iova)
 {
 	struct buffer_prot_info *protdesc = buffer->priv;
-	struct samsung_dma_heap *heap = buffer->heap;
-	struct device *dev;
-	unsigned long buf_size;
-	int ret = 0;
-
-	if (!protdesc || !heap)
-		return 0;
-
-	buf_size = protdesc->chunk_count * protdesc->chunk_size;
-
-	dev = dma_heap_get_dev(heap->dma_heap);
+	struct device *dev = dma_heap_get_dev(buffer->heap->dma_heap);
 
 	if (protdesc->chunk_count > 1)
 		dma_unmap_single(dev, phys_to_dma(dev, protdesc->bus_address),
 				 sizeof(unsigned long) * protdesc->chunk_count, DMA_TO_DEVICE);
 
+	if (free_iova)
+		secure_iova_free(protdesc->dma_addr,
+				 protdesc->chunk_count * protdesc->chunk_size);
+
+	kfree(protdesc);
+	buffer->priv = NULL;
+
+	put_pid(buffer->owner);
+	buffer->owner = NULL;
+}
+
+int samsung_dma_buffer_unprotect(struct samsung_dma_buffer *buffer)
+{
+	struct samsung_dma_heap *heap = buffer->heap;
+	int ret = 0;
+
+	if (!buffer->priv || !heap)
+		return 0;
+
 	if (!dma_heap_flags_dynamic_protected(heap->flags))
 		ret = buffer_unprotect_trusty(buffer);
 
@@ -144,10 +157,228 @@ int samsung_dma_buffer_unprotect(struct samsung_dma_buffer *buffer)
 	 * It might be unusable forever since we do not know the state of the
 	 * secure world before returning error from above.
 	 */
-	if (!ret)
-		secure_iova_free(protdesc->dma_addr, buf_size);
-
-	kfree(protdesc);
+	buffer_prot_info_free(buffer, !ret);
 
 	return ret;
 }
+
+/*
+ * Pool of released static-protected buffers. The buffers stay lent to the
+ * secure world with their secure iova, so reusing one skips the iova
+ * allocation, the Trusty lend on allocation and the reclaim on free. The
+ * pool is per heap, hence per protection id, and a buffer is only reused
+ * for an allocation of exactly its size. The kernel cannot clear a lent
+ * buffer, so it is handed back as is only to the process that allocated
+ * it. Another process gets it reclaimed, zeroed and lent again. The
+ * shrinker gives pooled buffers back to their heap under memory pressure.
+ */
+static LIST_HEAD(secure_pool_heaps);
+static DEFINE_MUTEX(secure_pool_heaps_lock); /* protects secure_pool_heaps */
+
+static void secure_pool_release(struct list_head *freelist)
+{
+	struct samsung_dma_buffer *buffer, *tmp;
+
+	list_for_each_entry_safe(buffer, tmp, freelist, pool) {
+		list_del(&buffer->pool);
+		buffer->heap->release(buffer);
+	}
+}
+
+static unsigned long secure_pool_count(struct shrinker *shrinker,
+				       struct shrink_control *sc)
+{
+	struct samsung_dma_heap *heap;
+	unsigned long size = 0;
+
+	mutex_lock(&secure_pool_heaps_lock);
+	list_for_each_entry(heap, &secure_pool_heaps, secure_pool_node)
+		size += READ_ONCE(heap->secure_pool_size);
+	mutex_unlock(&secure_pool_heaps_lock);
+
+	return (size >> PAGE_SHIFT) ?: SHRINK_EMPTY;
+}
+
+static unsigned long secure_pool_scan(struct shrinker *shrinker,
+				      struct shrink_control *sc)
+{
+	struct samsung_dma_heap *heap;
+	struct samsung_dma_buffer *buffer;
+	unsigned long freed = 0;
+	LIST_HEAD(freelist);
+
+	if (!mutex_trylock(&secure_pool_heaps_lock))
+		return SHRINK_STOP;
+
+	list_for_each_entry(heap, &secure_pool_heaps, secure_pool_node) {
+		spin_lock(&heap->secure_pool_lock);
+		/* oldest first */
+		while (freed < sc->nr_to_scan && !list_empty(&heap->secure_pool)) {
+			buffer = list_last_entry(&heap->secure_pool,
+						 struct samsung_dma_buffer, pool);
+			list_move(&buffer->pool, &freelist);
+			heap->secure_pool_size -= buffer->len;
+			freed += buffer->len >> PAGE_SHIFT;
+		}
+		spin_unlock(&heap->secure_pool_lock);
+
+		if (freed >= sc->nr_to_scan)
+			break;
+	}
+	mutex_unlock(&secure_pool_heaps_lock);
+
+	/* Trusty reclaims sleep, keep them out of the locks */
+	secure_pool_release(&freelist);
+
+	return freed ?: SHRINK_STOP;
+}
+
+static struct shrinker secure_pool_shrinker = {
+	.count_objects = secure_pool_count,
+	.scan_objects = secure_pool_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static void samsung_secure_pool_drain(void *data)
+{
+	struct samsung_dma_heap *heap = data;
+	LIST_HEAD(freelist);
+
+	mutex_lock(&secure_pool_heaps_lock);
+	list_del(&heap->secure_pool_node);
+	if (list_empty(&secure_pool_heaps))
+		unregister_shrinker(&secure_pool_shrinker);
+	mutex_unlock(&secure_pool_heaps_lock);
+
+	spin_lock(&heap->secure_pool_lock);
+	/* buffers released from now on go straight back to the heap */
+	heap->secure_pool_max = 0;
+	list_splice_init(&heap->secure_pool, &freelist);
+	heap->secure_pool_size = 0;
+	spin_unlock(&heap->secure_pool_lock);
+
+	secure_pool_release(&freelist);
+}
+
+int samsung_secure_pool_init(struct device *dev, struct samsung_dma_heap *heap,
+			     unsigned long max_size)
+{
+	int ret = 0;
+
+	spin_lock_init(&heap->secure_pool_lock);
+	INIT_LIST_HEAD(&heap->secure_pool);
+
+	if (!max_size || !dma_heap_flags_static_protected(heap->flags))
+		return 0;
+
+	mutex_lock(&secure_pool_heaps_lock);
+	if (list_empty(&secure_pool_heaps)) {
+		ret = register_shrinker(&secure_pool_shrinker, "samsung-secure-pool");
+		if (ret) {
+			perr("failed to register secure pool shrinker");
+			goto out;
+		}
+	}
+
+	heap->secure_pool_max = max_size;
+	list_add_tail(&heap->secure_pool_node, &secure_pool_heaps);
+out:
+	mutex_unlock(&secure_pool_heaps_lock);
+
+	if (ret)
+		return ret;
+
+	return devm_add_action_or_reset(dev, samsung_secure_pool_drain, heap);
+}
+
+/*
+ * Take back a lent buffer from the secure world, clear it and lend it again
+ * so that the content of the previous owner does not leak to the new one.
+ */
+static int secure_pool_scrub(struct samsung_dma_buffer *buffer)
+{
+	int ret;
+
+	ret = buffer_unprotect_trusty(buffer);
+	if (ret)
+		return ret;
+
+	heap_sgtable_pages_clean(&buffer->sg_table);
+	heap_cache_flush(buffer);
+
+	ret = buffer_protect_trusty(buffer, buffer->priv);
+	if (ret) {
+		/* already reclaimed, let the heap release free it unprotected */
+		buffer_prot_info_free(buffer, true);
+		return ret;
+	}
+
+	put_pid(buffer->owner);
+	buffer->owner = get_pid(task_tgid(current));
+
+	return 0;
+}
+
+struct dma_buf *samsung_secure_pool_export(struct samsung_dma_heap *heap,
+					   unsigned long size, unsigned long fd_flags)
+{
+	struct samsung_dma_buffer *buffer, *found = NULL;
+	struct pid *owner = task_tgid(current);
+	struct dma_buf *dmabuf;
+
+	if (!heap->secure_pool_max)
+		return NULL;
+
+	spin_lock(&heap->secure_pool_lock);
+	list_for_each_entry(buffer, &heap->secure_pool, pool) {
+		if (buffer->len != size)
+			continue;
+		if (!found || buffer->owner == owner)
+			found = buffer;
+		if (found->owner == owner)
+			break;
+	}
+	if (found) {
+		list_del(&found->pool);
+		heap->secure_pool_size -= size;
+	}
+	spin_unlock(&heap->secure_pool_lock);
+
+	if (!found)
+		return NULL;
+
+	if (found->owner != owner && secure_pool_scrub(found)) {
+		heap->release(found);
+		return NULL;
+	}
+
+	dmabuf = samsung_export_dmabuf(found, fd_flags);
+	if (IS_ERR(dmabuf)) {
+		if (!samsung_secure_pool_put(found))
+			heap->release(found);
+		return NULL;
+	}
+
+	return dmabuf;
+}
+
+/* Returns true if the pool took the buffer instead of the heap releasing it */
+bool samsung_secure_pool_put(struct samsung_dma_buffer *buffer)
+{
+	struct samsung_dma_heap *heap = buffer->heap;
+	bool pooled = false;
+
+	if (!READ_ONCE(heap->secure_pool_max) || !buffer->priv)
+		return false;
+
+	spin_lock(&heap->secure_pool_lock);
+	if (heap->secure_pool_size + buffer->len <= heap->secure_pool_max) {
+		/* most recently released first, they are likely reused soon */
+		list_add(&buffer->pool, &heap->secure_pool);
+		heap->secure_pool_size += buffer->len;
+		pooled = true;
+	}
+	spin_unlock(&heap->secure_pool_lock);
+
+	return pooled;
+}
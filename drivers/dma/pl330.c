@@ -374,10 +374,30 @@ enum pl330_cond {
 
 struct dma_pl330_desc;
 
+/*
+ * Everything the generated microcode depends on except the SAR/DAR
+ * addresses, which are always the second and third instructions.
+ */
+struct _pl330_mc_key {
+	u32 ccr;
+	u32 bytes;
+	enum dma_transfer_direction rqtype;
+	unsigned int infiniteloop;
+	unsigned int peri;
+	int ev;
+};
+
+/* Offsets of DMAMOV SAR/DAR, right after DMAMOV CCR */
+#define MC_SAR_OFF	SZ_DMAMOV
+#define MC_DAR_OFF	(2 * SZ_DMAMOV)
+
 struct _pl330_req {
 	u32 mc_bus;
 	void *mc_cpu;
 	struct dma_pl330_desc *desc;
+	/* Shape of the program left in mc_cpu, valid if mc_len != 0 */
+	struct _pl330_mc_key mc_key;
+	int mc_len;
 };
 
 /* ToBeDone for tasklet */
@@ -476,6 +496,15 @@ struct dma_pl330_chan {
 
 	/* for runtime pm tracking */
 	bool active;
+
+	/*
+	 * Descriptors released by this channel. Looked at before the DMAC
+	 * pool so that a channel recycling its own descriptors does not
+	 * contend on the DMAC-wide pool_lock.
+	 */
+	struct list_head desc_pool;
+	/* To protect desc_pool manipulation */
+	spinlock_t pool_lock;
 };
 
 struct pl330_dmac {
@@ -1718,6 +1747,25 @@ static inline u32 _prepare_ccr(const struct pl330_reqcfg *rqc)
 	return ccr;
 }
 
+static inline void _mc_key_init(struct _pl330_mc_key *key,
+				const struct _xfer_spec *pxs, int ev)
+{
+	key->ccr = pxs->ccr;
+	key->bytes = pxs->desc->px.bytes;
+	key->rqtype = pxs->desc->rqtype;
+	key->infiniteloop = pxs->desc->infiniteloop;
+	key->peri = pxs->desc->peri;
+	key->ev = ev;
+}
+
+static inline bool _mc_key_equal(const struct _pl330_mc_key *a,
+				 const struct _pl330_mc_key *b)
+{
+	return a->ccr == b->ccr && a->bytes == b->bytes &&
+	       a->rqtype == b->rqtype && a->infiniteloop == b->infiniteloop &&
+	       a->peri == b->peri && a->ev == b->ev;
+}
+
 /*
  * Submit a list of xfers after which the client wants notification.
  * Client is not notified after each xfer unit, just once after all
@@ -1728,6 +1776,8 @@ static int pl330_submit_req(struct pl330_thread *thrd,
 {
 	struct pl330_dmac *pl330 = thrd->dmac;
 	struct _xfer_spec xs;
+	struct _pl330_mc_key key;
+	struct _pl330_req *req;
 	unsigned long flags;
 	unsigned int idx;
 	u32 ccr;
@@ -1780,10 +1830,22 @@ static int pl330_submit_req(struct pl330_thread *thrd,
 	ccr = _prepare_ccr(&desc->rqcfg);
 
 	idx = thrd->req[0].desc == NULL ? 0 : 1;
+	req = &thrd->req[idx];
 
 	xs.ccr = ccr;
 	xs.desc = desc;
 
+	_mc_key_init(&key, &xs, thrd->ev);
+
+	if (req->mc_len && _mc_key_equal(&req->mc_key, &key)) {
+		/* Same shape as the program already there, patch addresses */
+		_emit_MOV(0, (u8 *)req->mc_cpu + MC_SAR_OFF, SAR,
+			  desc->px.src_addr);
+		_emit_MOV(0, (u8 *)req->mc_cpu + MC_DAR_OFF, DAR,
+			  desc->px.dst_addr);
+		goto hook;
+	}
+
 	/* First dry run to check if req is acceptable */
 	ret = _setup_req(pl330, 1, thrd, idx, &xs);
 	if (ret < 0)
@@ -1796,10 +1858,13 @@ static int pl330_submit_req(struct pl330_thread *thrd,
 		goto xfer_exit;
 	}
 
+	req->mc_len = _setup_req(pl330, 0, thrd, idx, &xs);
+	req->mc_key = key;
+
+hook:
 	/* Hook the request */
 	thrd->lstenq = idx;
-	thrd->req[idx].desc = desc;
-	_setup_req(pl330, 0, thrd, idx, &xs);
+	req->desc = desc;
 
 	if (np && pl330->wrapper) {
 		__raw_writel((xs.desc->px.src_addr >> 32) & 0xf, thrd->ar_wrapper);
@@ -2156,12 +2221,14 @@ static inline void _reset_thread(struct pl330_thread *thrd)
 	thrd->req[0].mc_bus = pl330->mcode_bus
 				+ (thrd->id * pl330->mcbufsz);
 	thrd->req[0].desc = NULL;
+	thrd->req[0].mc_len = 0;
 
 	thrd->req[1].mc_cpu = thrd->req[0].mc_cpu
 				+ pl330->mcbufsz / 2;
 	thrd->req[1].mc_bus = thrd->req[0].mc_bus
 				+ pl330->mcbufsz / 2;
 	thrd->req[1].desc = NULL;
+	thrd->req[1].mc_len = 0;
 
 	thrd->req_running = -1;
 }
@@ -2426,9 +2493,9 @@ static void pl330_tasklet(unsigned long data)
 			}
 		} else {
 			desc->status = FREE;
-			spin_lock(&pch->dmac->pool_lock);
-			list_move_tail(&desc->node, &pch->dmac->desc_pool);
-			spin_unlock(&pch->dmac->pool_lock);
+			spin_lock(&pch->pool_lock);
+			list_move_tail(&desc->node, &pch->desc_pool);
+			spin_unlock(&pch->pool_lock);
 		}
 
 		dma_descriptor_unmap(&desc->txd);
@@ -2620,9 +2687,11 @@ static int pl330_terminate_all(struct dma_chan *chan)
 		dma_cookie_complete(&desc->txd);
 	}
 
-	list_splice_tail_init(&pch->submitted_list, &pl330->desc_pool);
-	list_splice_tail_init(&pch->work_list, &pl330->desc_pool);
-	list_splice_tail_init(&pch->completed_list, &pl330->desc_pool);
+	spin_lock(&pch->pool_lock);
+	list_splice_tail_init(&pch->submitted_list, &pch->desc_pool);
+	list_splice_tail_init(&pch->work_list, &pch->desc_pool);
+	list_splice_tail_init(&pch->completed_list, &pch->desc_pool);
+	spin_unlock(&pch->pool_lock);
 	spin_unlock_irqrestore(&pch->lock, flags);
 	pm_runtime_mark_last_busy(pl330->ddma.dev);
 	if (power_down)
@@ -2673,8 +2742,14 @@ static void pl330_free_chan_resources(struct dma_chan *chan)
 	pl330_release_channel(pch->thread);
 	pch->thread = NULL;
 
+	/* Hand everything this channel held back to the DMAC pool */
+	spin_lock(&pl330->pool_lock);
 	if (pch->cyclic)
-		list_splice_tail_init(&pch->work_list, &pch->dmac->desc_pool);
+		list_splice_tail_init(&pch->work_list, &pl330->desc_pool);
+	spin_lock(&pch->pool_lock);
+	list_splice_tail_init(&pch->desc_pool, &pl330->desc_pool);
+	spin_unlock(&pch->pool_lock);
+	spin_unlock(&pl330->pool_lock);
 
 	spin_unlock_irqrestore(&pl330->lock, flags);
 	pm_runtime_mark_last_busy(pch->dmac->ddma.dev);
@@ -2901,8 +2976,10 @@ static struct dma_pl330_desc *pl330_get_desc(struct dma_pl330_chan *pch)
 	u8 *peri_id = pch->chan.private;
 	struct dma_pl330_desc *desc;
 
-	/* Pluck one desc from the pool of DMAC */
-	desc = pluck_desc(&pl330->desc_pool, &pl330->pool_lock);
+	/* Prefer a desc this channel released, then the pool of DMAC */
+	desc = pluck_desc(&pch->desc_pool, &pch->pool_lock);
+	if (!desc)
+		desc = pluck_desc(&pl330->desc_pool, &pl330->pool_lock);
 
 	/* If the DMAC pool is empty, alloc new */
 	if (!desc) {
@@ -2930,6 +3007,28 @@ static struct dma_pl330_desc *pl330_get_desc(struct dma_pl330_chan *pch)
 	return desc;
 }
 
+static void __pl330_giveback_desc(struct dma_pl330_chan *pch,
+				  struct dma_pl330_desc *first)
+{
+	unsigned long flags;
+	struct dma_pl330_desc *desc;
+
+	if (!first)
+		return;
+
+	spin_lock_irqsave(&pch->pool_lock, flags);
+
+	while (!list_empty(&first->node)) {
+		desc = list_entry(first->node.next,
+				struct dma_pl330_desc, node);
+		list_move_tail(&desc->node, &pch->desc_pool);
+	}
+
+	list_move_tail(&first->node, &pch->desc_pool);
+
+	spin_unlock_irqrestore(&pch->pool_lock, flags);
+}
+
 static inline void fill_px(struct pl330_xfer *px,
 		dma_addr_t dst, dma_addr_t src, size_t len)
 {
@@ -2991,7 +3090,6 @@ struct dma_async_tx_descriptor *__pl330_prep_dma_cyclic(struct dma_chan *chan,
 {
 	struct dma_pl330_desc *desc = NULL, *first = NULL;
 	struct dma_pl330_chan *pch = to_pchan(chan);
-	struct pl330_dmac *pl330 = pch->dmac;
 	unsigned int i;
 	dma_addr_t dst;
 	dma_addr_t src;
@@ -3014,25 +3112,10 @@ struct dma_async_tx_descriptor *__pl330_prep_dma_cyclic(struct dma_chan *chan,
 	for (i = 0; i < len / period_len; i++) {
 		desc = pl330_get_desc(pch);
 		if (!desc) {
-			unsigned long iflags;
-
 			dev_err(pch->dmac->ddma.dev, "%s:%d Unable to fetch desc\n",
 				__func__, __LINE__);
 
-			if (!first)
-				return NULL;
-
-			spin_lock_irqsave(&pl330->pool_lock, iflags);
-
-			while (!list_empty(&first->node)) {
-				desc = list_entry(first->node.next,
-						struct dma_pl330_desc, node);
-				list_move_tail(&desc->node, &pl330->desc_pool);
-			}
-
-			list_move_tail(&first->node, &pl330->desc_pool);
-
-			spin_unlock_irqrestore(&pl330->pool_lock, iflags);
+			__pl330_giveback_desc(pch, first);
 
 			return NULL;
 		}
@@ -3058,7 +3141,7 @@ struct dma_async_tx_descriptor *__pl330_prep_dma_cyclic(struct dma_chan *chan,
 		desc->rqcfg.brst_size = pch->burst_sz;
 		desc->rqcfg.brst_len = pch->burst_len;
 		desc->bytes_requested = period_len;
-		desc->infiniteloop = *infinite;
+		desc->infiniteloop = infinite ? *infinite : 0;
 		fill_px(&desc->px, dst, src, period_len);
 
 		if (!first)
@@ -3141,27 +3224,6 @@ pl330_prep_dma_memcpy(struct dma_chan *chan, dma_addr_t dst,
 	return &desc->txd;
 }
 
-static void __pl330_giveback_desc(struct pl330_dmac *pl330,
-				  struct dma_pl330_desc *first)
-{
-	unsigned long flags;
-	struct dma_pl330_desc *desc;
-
-	if (!first)
-		return;
-
-	spin_lock_irqsave(&pl330->pool_lock, flags);
-
-	while (!list_empty(&first->node)) {
-		desc = list_entry(first->node.next,
-				struct dma_pl330_desc, node);
-		list_move_tail(&desc->node, &pl330->desc_pool);
-	}
-
-	list_move_tail(&first->node, &pl330->desc_pool);
-
-	spin_unlock_irqrestore(&pl330->pool_lock, flags);
-}
 
 static struct dma_async_tx_descriptor *
 pl330_prep_slave_sg(struct dma_chan *chan, struct scatterlist *sgl,
@@ -3187,12 +3249,10 @@ pl330_prep_slave_sg(struct dma_chan *chan, struct scatterlist *sgl,
 
 		desc = pl330_get_desc(pch);
 		if (!desc) {
-			struct pl330_dmac *pl330 = pch->dmac;
-
 			dev_err(pch->dmac->ddma.dev,
 				"%s:%d Unable to fetch desc\n",
 				__func__, __LINE__);
-			__pl330_giveback_desc(pl330, first);
+			__pl330_giveback_desc(pch, first);
 
 			return NULL;
 		}
@@ -3487,7 +3547,9 @@ pl330_probe(struct amba_device *adev, const struct amba_id *id)
 		INIT_LIST_HEAD(&pch->submitted_list);
 		INIT_LIST_HEAD(&pch->work_list);
 		INIT_LIST_HEAD(&pch->completed_list);
+		INIT_LIST_HEAD(&pch->desc_pool);
 		spin_lock_init(&pch->lock);
+		spin_lock_init(&pch->pool_lock);
 		pch->thread = NULL;
 		pch->chan.device = pd;
 		pch->dmac = pl330;
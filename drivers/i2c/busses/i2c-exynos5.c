@@ -20,6 +20,8 @@
 #include <linux/clk.h>
 #include <linux/slab.h>
 #include <linux/io.h>
+#include <linux/iopoll.h>
+#include <linux/ktime.h>
 #include <linux/of_address.h>
 #include <linux/of_device.h>
 #include <linux/of_irq.h>
@@ -205,8 +207,18 @@
  * For hybrid polling mode:
  * If message length is below threshold, polling will be used.
  * Otherwise, the transaction will be handled by interrupt.
+ *
+ * HSI2C_HYBRID_THRESHOLD is only the starting point; the threshold follows
+ * the measured interrupt overhead of each bus, clamped to the range below.
+ * Every HSI2C_HYBRID_PROBE_PERIOD polled messages, one is sent by interrupt
+ * so the estimate can also move down again.
  */
 #define HSI2C_HYBRID_THRESHOLD 8
+#define HSI2C_HYBRID_THRESHOLD_MIN 1
+#define HSI2C_HYBRID_THRESHOLD_MAX HSI2C_FIFO_MAX
+#define HSI2C_HYBRID_PROBE_PERIOD 64
+/* Weight of a new sample in the overhead average, as a power of two */
+#define HSI2C_HYBRID_EWMA_SHIFT 3
 
 #define EXYNOS5_I2C_TIMEOUT (msecs_to_jiffies(100))
 #define EXYNOS5_FIFO_SIZE		16
@@ -642,7 +654,12 @@ static void exynos5_i2c_init(struct exynos5_i2c *i2c)
 
 	writel(i2c_conf | HSI2C_AUTO_MODE, i2c->regs + HSI2C_CONF);
 
+	/* The HW timeout is never used, transfers are timed by the driver */
+	writel(readl(i2c->regs + HSI2C_TIMEOUT) & ~HSI2C_TIMEOUT_EN,
+	       i2c->regs + HSI2C_TIMEOUT);
+
 	i2c->need_hw_init = 0;
+	i2c->conf_verified = 1;
 }
 
 static void exynos5_i2c_reset(struct exynos5_i2c *i2c)
@@ -671,6 +688,96 @@ static inline void exynos5_i2c_stop(struct exynos5_i2c *i2c)
 	complete(&i2c->msg_complete);
 }
 
+/*
+ * exynos5_i2c_drain_rx: read everything the RX FIFO currently holds
+ *
+ * FIFO_STATUS is read once and the reported level is drained in a burst,
+ * rather than re-reading the status before every byte.
+ */
+static void exynos5_i2c_drain_rx(struct exynos5_i2c *i2c)
+{
+	u32 fifo_status = readl(i2c->regs + HSI2C_FIFO_STATUS);
+	unsigned int count;
+
+	if (fifo_status & HSI2C_RX_FIFO_EMPTY)
+		return;
+
+	/* Not empty means at least one byte, whatever the level field says */
+	count = max_t(unsigned int, HSI2C_RX_FIFO_LVL(fifo_status), 1);
+	count = min_t(unsigned int, count, i2c->msg->len - i2c->msg_ptr);
+
+	while (count--)
+		i2c->msg->buf[i2c->msg_ptr++] =
+			(unsigned char)readl(i2c->regs + HSI2C_RX_DATA);
+}
+
+/*
+ * exynos5_i2c_fill_tx: top up the TX FIFO from the current message
+ *
+ * The free space is computed from one FIFO_STATUS read and written in a
+ * burst.
+ */
+static void exynos5_i2c_fill_tx(struct exynos5_i2c *i2c)
+{
+	u32 fifo_status = readl(i2c->regs + HSI2C_FIFO_STATUS);
+	unsigned int level = HSI2C_TX_FIFO_LVL(fifo_status);
+	unsigned int count;
+
+	if ((fifo_status & HSI2C_TX_FIFO_FULL) || level >= EXYNOS5_FIFO_SIZE)
+		return;
+
+	count = min_t(unsigned int, EXYNOS5_FIFO_SIZE - level,
+		      i2c->msg->len - i2c->msg_ptr);
+
+	while (count--)
+		writel(i2c->msg->buf[i2c->msg_ptr++],
+		       i2c->regs + HSI2C_TX_DATA);
+}
+
+/*
+ * exynos5_i2c_hybrid_mode: pick polling or interrupt for one message
+ *
+ * Polling spins for roughly the wire time of the message, an interrupt
+ * costs irq_overhead_ns of extra latency. Whichever is cheaper wins.
+ */
+static int exynos5_i2c_hybrid_mode(struct exynos5_i2c *i2c,
+				   struct i2c_msg *msgs)
+{
+	if (msgs->len > i2c->hybrid_threshold)
+		return HSI2C_INTERRUPT;
+
+	if (++i2c->hybrid_probe_cnt >= HSI2C_HYBRID_PROBE_PERIOD) {
+		i2c->hybrid_probe_cnt = 0;
+		return HSI2C_INTERRUPT;
+	}
+
+	return HSI2C_POLLING;
+}
+
+/*
+ * exynos5_i2c_hybrid_update: account one completed interrupt message
+ *
+ * @elapsed_ns covers programming the message until its completion was
+ * observed; anything beyond the wire time is interrupt overhead.
+ */
+static void exynos5_i2c_hybrid_update(struct exynos5_i2c *i2c,
+				      unsigned int len, u64 elapsed_ns)
+{
+	u64 wire_ns = (u64)(len + 1) * i2c->byte_ns;
+	u64 sample = elapsed_ns > wire_ns ? elapsed_ns - wire_ns : 0;
+	unsigned int threshold;
+
+	sample = min_t(u64, sample, U32_MAX);
+	i2c->irq_overhead_ns = i2c->irq_overhead_ns -
+		(i2c->irq_overhead_ns >> HSI2C_HYBRID_EWMA_SHIFT) +
+		((u32)sample >> HSI2C_HYBRID_EWMA_SHIFT);
+
+	threshold = i2c->irq_overhead_ns / i2c->byte_ns;
+	i2c->hybrid_threshold = clamp_t(unsigned int, threshold,
+					HSI2C_HYBRID_THRESHOLD_MIN,
+					HSI2C_HYBRID_THRESHOLD_MAX);
+}
+
 /*
  * exynos5_i2c_irq: top level IRQ servicing routine
  *
@@ -684,7 +791,6 @@ static irqreturn_t exynos5_i2c_irq(int irqno, void *dev_id)
 	struct exynos5_i2c *i2c = dev_id;
 	unsigned long reg_val;
 	unsigned long trans_status;
-	unsigned char byte;
 
 	if (!i2c) {
 		pr_err("irq nodev (irqno:%d)\n", irqno);
@@ -697,12 +803,7 @@ static irqreturn_t exynos5_i2c_irq(int irqno, void *dev_id)
 	}
 
 	if (i2c->msg->flags & I2C_M_RD) {
-		while (i2c->msg_ptr < i2c->msg->len &&
-				!(readl(i2c->regs + HSI2C_FIFO_STATUS) &
-					HSI2C_RX_FIFO_EMPTY)) {
-			byte = (unsigned char)readl(i2c->regs + HSI2C_RX_DATA);
-			i2c->msg->buf[i2c->msg_ptr++] = byte;
-		}
+		exynos5_i2c_drain_rx(i2c);
 
 		if (i2c->msg_ptr >= i2c->msg->len) {
 			reg_val = readl(i2c->regs + HSI2C_INT_ENABLE);
@@ -711,16 +812,12 @@ static irqreturn_t exynos5_i2c_irq(int irqno, void *dev_id)
 			exynos5_i2c_stop(i2c);
 		}
 	} else {
-		while ((readl(i2c->regs + HSI2C_FIFO_STATUS) &
-			HSI2C_TX_FIFO_FULL) == 0) {
-			if (i2c->msg_ptr >= i2c->msg->len) {
-				reg_val = readl(i2c->regs + HSI2C_INT_ENABLE);
-				reg_val &= ~(HSI2C_INT_TX_ALMOSTEMPTY_EN);
-				writel(reg_val, i2c->regs + HSI2C_INT_ENABLE);
-				break;
-			}
-			byte = i2c->msg->buf[i2c->msg_ptr++];
-			writel(byte, i2c->regs + HSI2C_TX_DATA);
+		exynos5_i2c_fill_tx(i2c);
+
+		if (i2c->msg_ptr >= i2c->msg->len) {
+			reg_val = readl(i2c->regs + HSI2C_INT_ENABLE);
+			reg_val &= ~(HSI2C_INT_TX_ALMOSTEMPTY_EN);
+			writel(reg_val, i2c->regs + HSI2C_INT_ENABLE);
 		}
 	}
 
@@ -768,12 +865,11 @@ static int exynos5_i2c_xfer_msg(struct exynos5_i2c *i2c,
 	unsigned long trans_status;
 	unsigned long i2c_ctl;
 	unsigned long i2c_auto_conf;
-	unsigned long i2c_timeout;
 	unsigned long i2c_addr;
 	unsigned long i2c_int_en;
 	unsigned long i2c_fifo_ctl;
 	unsigned long trig_level;
-	unsigned char byte;
+	u64 start_ns = 0, end_ns = 0;
 	int ret = 0;
 	int operation_mode = i2c->operation_mode;
 
@@ -782,10 +878,8 @@ static int exynos5_i2c_xfer_msg(struct exynos5_i2c *i2c,
 	i2c->trans_done = 0;
 
 	/* For hybrid polling, operation mode is determined by message length */
-	if (operation_mode == HSI2C_HYBRID_POLLING) {
-		operation_mode = (msgs->len > HSI2C_HYBRID_THRESHOLD) ?
-			HSI2C_INTERRUPT : HSI2C_POLLING;
-	}
+	if (operation_mode == HSI2C_HYBRID_POLLING)
+		operation_mode = exynos5_i2c_hybrid_mode(i2c, msgs);
 
 	/* (length * (bits + ack) * (s/ms) * / freq) * (tolerance) */
 	timeout_max = (i2c->msg->len * 9 * 1000 / i2c->clock_frequency) * 2;
@@ -797,9 +891,6 @@ static int exynos5_i2c_xfer_msg(struct exynos5_i2c *i2c,
 
 	i2c_ctl = readl(i2c->regs + HSI2C_CTL);
 	i2c_auto_conf = readl(i2c->regs + HSI2C_AUTO_CONF);
-	i2c_timeout = readl(i2c->regs + HSI2C_TIMEOUT);
-	i2c_timeout &= ~HSI2C_TIMEOUT_EN;
-	writel(i2c_timeout, i2c->regs + HSI2C_TIMEOUT);
 
 	/*
 	 * In case of short length request it'd be better to set
@@ -874,6 +965,10 @@ static int exynos5_i2c_xfer_msg(struct exynos5_i2c *i2c,
 	i2c_auto_conf |= i2c->msg->len;
 	writel(i2c_auto_conf, i2c->regs + HSI2C_AUTO_CONF);
 
+	if (operation_mode == HSI2C_INTERRUPT &&
+	    i2c->operation_mode == HSI2C_HYBRID_POLLING)
+		start_ns = ktime_get_ns();
+
 	i2c_auto_conf = readl(i2c->regs + HSI2C_AUTO_CONF);
 	i2c_auto_conf |= HSI2C_MASTER_RUN;
 	writel(i2c_auto_conf, i2c->regs + HSI2C_AUTO_CONF);
@@ -882,16 +977,8 @@ static int exynos5_i2c_xfer_msg(struct exynos5_i2c *i2c,
 	if (msgs->flags & I2C_M_RD && operation_mode == HSI2C_POLLING) {
 		timeout = jiffies + msecs_to_jiffies(timeout_max);
 		while (time_before(jiffies, timeout) &&
-				i2c->msg_ptr < i2c->msg->len) {
-			if ((readl(i2c->regs + HSI2C_FIFO_STATUS) &
-						HSI2C_RX_FIFO_EMPTY) == 0) {
-				/* RX FIFO is not empty */
-				byte = (unsigned char)readl
-					(i2c->regs + HSI2C_RX_DATA);
-				i2c->msg->buf[i2c->msg_ptr++] = byte;
-			}
-
-		}
+				i2c->msg_ptr < i2c->msg->len)
+			exynos5_i2c_drain_rx(i2c);
 		if (i2c->msg_ptr >= i2c->msg->len)
 			ret = 0;
 
@@ -906,6 +993,8 @@ static int exynos5_i2c_xfer_msg(struct exynos5_i2c *i2c,
 		timeout = wait_for_completion_timeout
 			(&i2c->msg_complete,
 			 msecs_to_jiffies(timeout_max));
+		if (start_ns)
+			end_ns = ktime_get_ns();
 
 		ret = 0;
 
@@ -945,29 +1034,27 @@ static int exynos5_i2c_xfer_msg(struct exynos5_i2c *i2c,
 	} else if (!(msgs->flags & I2C_M_RD) &&
 			operation_mode == HSI2C_POLLING) {
 		unsigned long int_status;
-		unsigned long fifo_status;
+		unsigned long remain;
 
 		timeout = jiffies + msecs_to_jiffies(timeout_max);
 		while (time_before(jiffies, timeout) &&
-		       (i2c->msg_ptr < i2c->msg->len)) {
-			if ((readl(i2c->regs + HSI2C_FIFO_STATUS)
-						& HSI2C_TX_FIFO_LVL_MASK) <
-					EXYNOS5_FIFO_SIZE) {
-				byte = i2c->msg->buf[i2c->msg_ptr++];
-				writel(byte, i2c->regs + HSI2C_TX_DATA);
-			}
-		}
-		while (time_before(jiffies, timeout)) {
-			int_status = readl(i2c->regs + HSI2C_INT_STATUS);
-			fifo_status = readl(i2c->regs + HSI2C_FIFO_STATUS);
-			if (int_status & HSI2C_INT_TRANSFER_DONE &&
-			    fifo_status & HSI2C_TX_FIFO_EMPTY) {
-				writel(int_status, i2c->regs +
-						HSI2C_INT_STATUS);
-				ret = 0;
-				break;
-			}
-			udelay(1);
+		       (i2c->msg_ptr < i2c->msg->len))
+			exynos5_i2c_fill_tx(i2c);
+
+		/*
+		 * The remaining wire time is at most a FIFO's worth of bytes,
+		 * so spin on the status without the 1us udelay granularity.
+		 */
+		remain = time_before(jiffies, timeout) ? timeout - jiffies : 0;
+		if (i2c->msg_ptr >= i2c->msg->len &&
+		    !readl_poll_timeout_atomic(i2c->regs + HSI2C_INT_STATUS,
+				int_status,
+				(int_status & HSI2C_INT_TRANSFER_DONE) &&
+				(readl(i2c->regs + HSI2C_FIFO_STATUS) &
+				 HSI2C_TX_FIFO_EMPTY),
+				0, jiffies_to_usecs(remain) + 1)) {
+			writel(int_status, i2c->regs + HSI2C_INT_STATUS);
+			ret = 0;
 		}
 		if (ret == -EAGAIN) {
 			dump_i2c_register(i2c);
@@ -980,6 +1067,8 @@ static int exynos5_i2c_xfer_msg(struct exynos5_i2c *i2c,
 		timeout = wait_for_completion_timeout
 			(&i2c->msg_complete,
 			 msecs_to_jiffies(timeout_max));
+		if (start_ns)
+			end_ns = ktime_get_ns();
 		disable_irq(i2c->irq);
 
 		if (timeout == 0) {
@@ -1018,6 +1107,9 @@ static int exynos5_i2c_xfer_msg(struct exynos5_i2c *i2c,
 		ret = 0;
 	}
 
+	if (!ret && start_ns)
+		exynos5_i2c_hybrid_update(i2c, msgs->len, end_ns - start_ns);
+
 	return ret;
 }
 
@@ -1072,11 +1164,18 @@ static int exynos5_i2c_xfer(struct i2c_adapter *adap,
 	if (i2c->need_hw_init)
 		exynos5_i2c_reset(i2c);
 
-	if (unlikely(!(readl(i2c->regs + HSI2C_CONF)
-			& HSI2C_AUTO_MODE))) {
-		dev_err(i2c->dev, "HSI2C should be reconfigured\n");
-		exynos5_hsi2c_clock_setup(i2c);
-		exynos5_i2c_init(i2c);
+	/*
+	 * CONF only loses AUTO_MODE when the controller was powered down, so
+	 * it is checked once per power cycle rather than on every transfer.
+	 */
+	if (!i2c->conf_verified) {
+		if (unlikely(!(readl(i2c->regs + HSI2C_CONF)
+				& HSI2C_AUTO_MODE))) {
+			dev_err(i2c->dev, "HSI2C should be reconfigured\n");
+			exynos5_hsi2c_clock_setup(i2c);
+			exynos5_i2c_init(i2c);
+		}
+		i2c->conf_verified = 1;
 	}
 
 	for (retry = 0; retry < adap->retries; retry++) {
@@ -1214,6 +1313,11 @@ static int exynos5_i2c_probe(struct platform_device *pdev)
 	if (!ret)
 		dev_warn(&pdev->dev, "tSCL_LOW val: 0x%x\n", i2c->tscl_l);
 
+	i2c->byte_ns = DIV_ROUND_UP_ULL(9ULL * NSEC_PER_SEC,
+					 i2c->clock_frequency);
+	i2c->hybrid_threshold = HSI2C_HYBRID_THRESHOLD;
+	i2c->irq_overhead_ns = HSI2C_HYBRID_THRESHOLD * i2c->byte_ns;
+
 	/* Mode of operation Polling/Interrupt mode */
 	if (of_get_property(np, "samsung,polling-mode", NULL))
 		i2c->operation_mode = HSI2C_POLLING;
@@ -1395,6 +1499,7 @@ static int exynos5_i2c_runtime_suspend(struct device *dev)
 	clk_disable(i2c->clk);
 	exynos_update_ip_idle_status(i2c->idle_ip_index, 1);
 	i2c->runtime_resumed = 0;
+	i2c->conf_verified = 0;
 
 	return 0;
 }
@@ -1453,6 +1558,7 @@ static int exynos5_i2c_suspend_noirq(struct device *dev)
 	if (!pm_runtime_status_suspended(dev))
 		exynos5_i2c_runtime_suspend(dev);
 
+	i2c->conf_verified = 0;
 	i2c->suspended = 1;
 	i2c_unlock_bus(&i2c->adap, I2C_LOCK_ROOT_ADAPTER);
 
@@ -73,5 +73,20 @@ struct exynos5_i2c {
 	int			nack_restart;
 
 	unsigned int 		trailing_count;
+
+	/*
+	 * Hybrid polling bookkeeping: byte_ns is the wire time of one byte
+	 * (8 data bits + ACK) at clock_frequency, irq_overhead_ns is a running
+	 * average of how much longer than the wire time an interrupt-driven
+	 * message takes. Messages shorter than hybrid_threshold bytes cost
+	 * less CPU spinning than sleeping, so they are polled.
+	 */
+	unsigned int		byte_ns;
+	unsigned int		irq_overhead_ns;
+	unsigned int		hybrid_threshold;
+	unsigned int		hybrid_probe_cnt;
+
+	/* CONF was checked since the controller was last powered */
+	unsigned int		conf_verified:1;
 };
 #endif /*__I2C_EXYNOS5_H */
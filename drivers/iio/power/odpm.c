@@ -19,13 +19,17 @@
 #include <linux/timer.h>
 #include <linux/alarmtimer.h>
 #include <linux/kmod.h>
+#include <linux/math64.h>
 #include <linux/slab.h>
 #include <linux/platform_device.h>
 
 #include <linux/i2c.h>
 #include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
 #include <linux/iio/configfs.h>
 #include <linux/iio/sysfs.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
 
 #include <linux/of_device.h>
 #include <linux/pinctrl/consumer.h>
@@ -87,21 +91,36 @@
 		.type = IIO_ENERGY, .indexed = 1, .channel = (_index),         \
 		.info_mask_separate = BIT(IIO_CHAN_INFO_AVERAGE_RAW),          \
 		.info_mask_shared_by_dir = BIT(IIO_CHAN_INFO_SAMP_FREQ),       \
+		.scan_index = -1,                                              \
 	}
 #define ODPM_CURRENT_BIT_RES_CHANNEL(_index)                                               \
 	{                                                                      \
 		.type = IIO_CURRENT, .indexed = 1, .channel = (_index),         \
 		.info_mask_separate = BIT(IIO_CHAN_INFO_SCALE),          \
 		.info_mask_shared_by_dir = BIT(IIO_CHAN_INFO_SAMP_FREQ),       \
+		.scan_index = -1,                                              \
 	}
 #define ODPM_POWER_BIT_RES_CHANNEL(_index)                                               \
 	{                                                                      \
 		.type = IIO_POWER, .indexed = 1, .channel = (_index),         \
 		.info_mask_separate = BIT(IIO_CHAN_INFO_SCALE),          \
 		.info_mask_shared_by_dir = BIT(IIO_CHAN_INFO_SAMP_FREQ),       \
+		.scan_index = -1,                                              \
+	}
+/* Buffered samples are the average power in uW over a refresh interval */
+#define ODPM_POWER_AVG_CHANNEL(_index)                                         \
+	{                                                                      \
+		.type = IIO_POWER, .indexed = 1, .channel = (_index),         \
+		.extend_name = "average",                                      \
+		.info_mask_separate = BIT(IIO_CHAN_INFO_SCALE),                \
+		.scan_index = (_index),                                        \
+		.scan_type = {                                                 \
+			.sign = 'u', .realbits = 64, .storagebits = 64,        \
+			.endianness = IIO_CPU,                                 \
+		},                                                             \
 	}
 
-static const struct iio_chan_spec s2mpg1415_single_channel[ODPM_CHANNEL_MAX * 3] = {
+static const struct iio_chan_spec s2mpg1415_single_channel[ODPM_CHANNEL_MAX * 4 + 1] = {
 	ODPM_ACC_CHANNEL(0), ODPM_ACC_CHANNEL(1),
 	ODPM_ACC_CHANNEL(2), ODPM_ACC_CHANNEL(3),
 	ODPM_ACC_CHANNEL(4), ODPM_ACC_CHANNEL(5),
@@ -120,6 +139,13 @@ static const struct iio_chan_spec s2mpg1415_single_channel[ODPM_CHANNEL_MAX * 3]
 	ODPM_POWER_BIT_RES_CHANNEL(6), ODPM_POWER_BIT_RES_CHANNEL(7),
 	ODPM_POWER_BIT_RES_CHANNEL(8), ODPM_POWER_BIT_RES_CHANNEL(9),
 	ODPM_POWER_BIT_RES_CHANNEL(10), ODPM_POWER_BIT_RES_CHANNEL(11),
+	ODPM_POWER_AVG_CHANNEL(0), ODPM_POWER_AVG_CHANNEL(1),
+	ODPM_POWER_AVG_CHANNEL(2), ODPM_POWER_AVG_CHANNEL(3),
+	ODPM_POWER_AVG_CHANNEL(4), ODPM_POWER_AVG_CHANNEL(5),
+	ODPM_POWER_AVG_CHANNEL(6), ODPM_POWER_AVG_CHANNEL(7),
+	ODPM_POWER_AVG_CHANNEL(8), ODPM_POWER_AVG_CHANNEL(9),
+	ODPM_POWER_AVG_CHANNEL(10), ODPM_POWER_AVG_CHANNEL(11),
+	IIO_CHAN_SOFT_TIMESTAMP(ODPM_CHANNEL_MAX),
 };
 
 static const u32 s2mpg1415_int_sample_rate_uhz[INT_FREQ_COUNT] = {
@@ -153,6 +179,63 @@ static u64 to_ms(u64 ns)
 	return ns / NSEC_PER_MSEC;
 }
 
+/* Must be called with info->lock held */
+static void odpm_publish_snapshot_locked(struct odpm_info *info)
+{
+	int ch;
+
+	write_seqcount_begin(&info->snapshot_seq);
+	info->snapshot.acc_timestamp_ms = info->chip.acc_timestamp_ms;
+	info->snapshot.last_poll_ktime_boot_ns = info->last_poll_ktime_boot_ns;
+	for (ch = 0; ch < ODPM_CHANNEL_MAX; ch++) {
+		info->snapshot.rail_i[ch] = info->channels[ch].rail_i;
+		info->snapshot.measurement_start_ms[ch] =
+			info->channels[ch].measurement_start_ms;
+		info->snapshot.acc_power_uW_sec[ch] =
+			info->channels[ch].acc_power_uW_sec;
+		info->snapshot.interval_power_uW_sec[ch] =
+			info->channels[ch].interval_power_uW_sec;
+	}
+	info->snapshot.last_interval_ns = info->last_interval_ns;
+	write_seqcount_end(&info->snapshot_seq);
+}
+
+static void odpm_read_snapshot(struct odpm_info *info,
+			       struct odpm_snapshot *snapshot)
+{
+	unsigned int seq;
+
+	do {
+		seq = read_seqcount_begin(&info->snapshot_seq);
+		*snapshot = info->snapshot;
+	} while (read_seqcount_retry(&info->snapshot_seq, seq));
+}
+
+static u64 odpm_get_min_refresh_ns(struct odpm_info *info)
+{
+	int i = info->chip.int_sampling_rate_i;
+	u32 freq = info->chip.sampling_rate_int_uhz[i];
+
+	return (u64)ODPM_MIN_INTERVAL_ACC_COUNT * NSEC_PER_SEC * UHZ_PER_HZ /
+		freq;
+}
+
+/* Readers never touch the meter themselves. They get the published snapshot
+ * and, once it is older than the minimum refresh interval, hand the refresh
+ * off to the refresh work and return the cached values. A reader therefore
+ * sees data at most one refresh behind; the alarm still guarantees a refresh
+ * before the accumulators can saturate.
+ */
+static void odpm_get_snapshot(struct odpm_info *info,
+			      struct odpm_snapshot *snapshot)
+{
+	odpm_read_snapshot(info, snapshot);
+
+	if (ktime_get_boottime_ns() - snapshot->last_poll_ktime_boot_ns >
+	    odpm_get_min_refresh_ns(info))
+		queue_work(info->work_queue, &info->work_refresh);
+}
+
 static int odpm_io_set_channel(struct odpm_info *info, int channel)
 {
 	int ret = -1;
@@ -368,6 +451,7 @@ int odpm_configure_start_measurement(struct odpm_info *info)
 		if (info->channels[ch].enabled)
 			info->channels[ch].measurement_start_ms = 0;
 	}
+	odpm_publish_snapshot_locked(info);
 
 	return ret;
 }
@@ -378,6 +462,7 @@ static enum alarmtimer_restart odpm_alarm_handler(struct alarm *alarm, ktime_t t
 		container_of(alarm, struct odpm_info, alarmtimer_refresh);
 
 	__pm_stay_awake(info->ws);
+	atomic_set(&info->alarm_refresh_pending, 1);
 
 	/* schedule the periodic reading from the chip */
 	queue_work(info->work_queue, &info->work_refresh);
@@ -391,14 +476,17 @@ static void odpm_periodic_refresh_work(struct work_struct *work)
 {
 	struct odpm_info *info =
 		container_of(work, struct odpm_info, work_refresh);
+	/* Readers queue this work too, only the alarm holds the wakeup source */
+	bool relax = atomic_xchg(&info->alarm_refresh_pending, 0);
 
 	if (odpm_take_snapshot(info) < 0)
 		pr_err("odpm: Cannot refresh %s registers periodically!\n",
 		       info->chip.name);
 	else
-		pr_info("odpm: Refreshed %s registers!\n", info->chip.name);
+		pr_debug("odpm: Refreshed %s registers!\n", info->chip.name);
 
-	__pm_relax(info->ws);
+	if (relax)
+		__pm_relax(info->ws);
 }
 
 static void odpm_periodic_refresh_setup(struct odpm_info *info)
@@ -928,6 +1016,7 @@ static int odpm_refresh_registers(struct odpm_info *info, bool resume)
 	}
 
 	/* Store timestamps - the rest of the function will succeed */
+	info->last_interval_ns = timestamp_after_async - timestamp_previous_sample;
 	info->last_poll_ktime_boot_ns = timestamp_after_async;
 	info->chip.acc_timestamp_ms = to_ms(timestamp_after_async);
 
@@ -946,6 +1035,8 @@ static int odpm_refresh_registers(struct odpm_info *info, bool resume)
 		struct odpm_rail_data *rail = &info->chip.rails[rail_i];
 		u64 uW_sec;
 
+		info->channels[ch].interval_power_uW_sec = 0;
+
 		/* Do not add energy on rails that were disabled during sleep */
 		if (resume && rail->disable_in_sleep)
 			continue;
@@ -953,9 +1044,12 @@ static int odpm_refresh_registers(struct odpm_info *info, bool resume)
 		uW_sec = odpm_calculate_uW_sec(info, rail_i, acc_data[ch],
 					       (u32)sampling_frequency_uhz);
 
+		info->channels[ch].interval_power_uW_sec = uW_sec;
 		info->channels[ch].acc_power_uW_sec += uW_sec;
 	}
 
+	odpm_publish_snapshot_locked(info);
+
 exit_refresh:
 	return ret;
 }
@@ -990,10 +1084,7 @@ static int odpm_take_snapshot_locked(struct odpm_info *info)
 	 * re-read the chip, otherwise the cached info is just fine
 	 */
 
-	int i = info->chip.int_sampling_rate_i;
-	u32 freq = info->chip.sampling_rate_int_uhz[i];
-	u64 min_time_ns = (u64)ODPM_MIN_INTERVAL_ACC_COUNT * NSEC_PER_SEC *
-		UHZ_PER_HZ / freq;
+	u64 min_time_ns = odpm_get_min_refresh_ns(info);
 	u64 now_ns = ktime_get_boottime_ns();
 
 	if (now_ns > info->last_poll_ktime_boot_ns + min_time_ns)
@@ -1297,15 +1388,11 @@ static ssize_t energy_value_show(struct device *dev,
 {
 	struct iio_dev *indio_dev = dev_to_iio_dev(dev);
 	struct odpm_info *info = iio_priv(indio_dev);
+	struct odpm_snapshot snapshot;
 	ssize_t count = 0;
 	int ch;
 
-	/* take snapshot */
-	mutex_lock(&info->lock);
-	if (odpm_take_snapshot_locked(info) < 0) {
-		pr_err("odpm: cannot retrieve energy values\n");
-		goto energy_value_show_exit;
-	}
+	odpm_get_snapshot(info, &snapshot);
 
 	/**
 	 * Output format:
@@ -1313,26 +1400,23 @@ static ssize_t energy_value_show(struct device *dev,
 	 * CH<N>(T=<Duration, ms>)[<Schematic name>], <Accumulated Energy, uWs>
 	 */
 	count += scnprintf(buf + count, PAGE_SIZE - count, "t=%llu\n",
-			   info->chip.acc_timestamp_ms);
+			   snapshot.acc_timestamp_ms);
 
 	for (ch = 0; ch < ODPM_CHANNEL_MAX; ch++) {
-		int rail_i = info->channels[ch].rail_i;
-		u64 start_ms = info->channels[ch].measurement_start_ms;
+		int rail_i = snapshot.rail_i[ch];
+		u64 start_ms = snapshot.measurement_start_ms[ch];
 		u64 duration_ms = 0;
 
-		if (info->chip.acc_timestamp_ms >= start_ms)
-			duration_ms = info->chip.acc_timestamp_ms - start_ms;
+		if (snapshot.acc_timestamp_ms >= start_ms)
+			duration_ms = snapshot.acc_timestamp_ms - start_ms;
 
 		count += scnprintf(buf + count, PAGE_SIZE - count,
 				   "CH%d(T=%llu)[%s], %llu\n", ch,
 				   duration_ms,
 				   info->chip.rails[rail_i].schematic_name,
-				   info->channels[ch].acc_power_uW_sec);
+				   snapshot.acc_power_uW_sec[ch]);
 	}
 
-energy_value_show_exit:
-	mutex_unlock(&info->lock);
-
 	return count;
 }
 
@@ -1493,6 +1577,8 @@ static ssize_t enabled_rails_store(struct device *dev,
 	info->channels[channel].measurement_start_ms = to_ms(timestamp_ns);
 	info->chip.rails[new_rail].measurement_stop_ms = 0;
 
+	odpm_publish_snapshot_locked(info);
+
 enabled_rails_store_exit:
 	mutex_unlock(&info->lock);
 
@@ -1714,6 +1800,7 @@ static int odpm_read_raw(struct iio_dev *indio_dev,
 {
 	struct odpm_info *info = iio_priv(indio_dev);
 	const int rail_i = info->channels[chan->channel].rail_i;
+	struct odpm_snapshot snapshot;
 	int ret = 0;
 	u64 milli_res_iq30;
 
@@ -1721,7 +1808,10 @@ static int odpm_read_raw(struct iio_dev *indio_dev,
 	case IIO_CHAN_INFO_AVERAGE_RAW:
 		switch (chan->type) {
 		case IIO_ENERGY:
-			break;
+			odpm_get_snapshot(info, &snapshot);
+			*val = lower_32_bits(snapshot.acc_power_uW_sec[chan->channel]);
+			*val2 = upper_32_bits(snapshot.acc_power_uW_sec[chan->channel]);
+			return IIO_VAL_INT_64;
 		default:
 			break;
 		}
@@ -1738,6 +1828,12 @@ static int odpm_read_raw(struct iio_dev *indio_dev,
 			*val2 = (u32)_IQ30_to_int(milli_res_iq30 * PICO_PER_MILLI) % PICO_PER_MILLI;
 			return IIO_VAL_INT_PLUS_NANO;
 		case IIO_POWER:
+			/* Buffered averages are in uW, IIO power is in mW */
+			if (chan->scan_index >= 0) {
+				*val = 0;
+				*val2 = 1000;
+				return IIO_VAL_INT_PLUS_MICRO;
+			}
 			mutex_lock(&info->lock);
 			milli_res_iq30 = odpm_get_resolution_milli_iq30(info,
 									rail_i,
@@ -1768,6 +1864,46 @@ static int odpm_write_raw(struct iio_dev *indio_dev,
 	return ret;
 }
 
+/*
+ * Triggered buffer handler: push the average power of every enabled channel
+ * over the last refresh interval, so a power time series can be read in bulk
+ * instead of diffing energy_value. The samples come from the published
+ * snapshot, so the trigger rate does not drive meter reads; a sample is only
+ * pushed once per refresh.
+ */
+static irqreturn_t odpm_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct odpm_info *info = iio_priv(indio_dev);
+	struct odpm_snapshot snapshot;
+	/* One u64 per channel plus the aligned s64 timestamp */
+	u64 data[ODPM_CHANNEL_MAX + 1] = { 0 };
+	int bit, i = 0;
+
+	odpm_get_snapshot(info, &snapshot);
+	if (!snapshot.last_interval_ns ||
+	    snapshot.last_poll_ktime_boot_ns == info->buffer_last_poll_ns)
+		goto trigger_handler_exit;
+	info->buffer_last_poll_ns = snapshot.last_poll_ktime_boot_ns;
+
+	for_each_set_bit(bit, indio_dev->active_scan_mask,
+			 indio_dev->masklength) {
+		if (bit >= ODPM_CHANNEL_MAX)
+			break;
+		data[i++] = mul_u64_u64_div_u64(snapshot.interval_power_uW_sec[bit],
+						NSEC_PER_SEC,
+						snapshot.last_interval_ns);
+	}
+
+	iio_push_to_buffers_with_timestamp(indio_dev, data, pf->timestamp);
+
+trigger_handler_exit:
+	iio_trigger_notify_done(indio_dev->trig);
+
+	return IRQ_HANDLED;
+}
+
 static const struct iio_info odpm_iio_info = {
 	.attrs = &odpm_group,
 	.read_raw = odpm_read_raw,
@@ -1902,6 +2038,8 @@ static int odpm_probe(struct platform_device *pdev)
 		return ret;
 	}
 	/* Initialize other data in odpm_info */
+	mutex_init(&odpm_info->lock);
+	seqcount_mutex_init(&odpm_info->snapshot_seq, &odpm_info->lock);
 
 	/* Configure ODPM channels based on device tree input */
 	ret = odpm_configure_chip(odpm_info);
@@ -1911,8 +2049,10 @@ static int odpm_probe(struct platform_device *pdev)
 	}
 
 	/* Start measurement of default rails */
+	mutex_lock(&odpm_info->lock);
 	if (odpm_configure_start_measurement(odpm_info))
 		pr_err("odpm: Failed to start measurement at probe\n");
+	mutex_unlock(&odpm_info->lock);
 
 	/* Configure work to kick off every XHz */
 	odpm_periodic_refresh_setup(odpm_info);
@@ -1924,6 +2064,14 @@ static int odpm_probe(struct platform_device *pdev)
 	indio_dev->name = pdev->name;
 	indio_dev->dev.parent = &pdev->dev;
 	indio_dev->modes = INDIO_DIRECT_MODE;
+	ret = devm_iio_triggered_buffer_setup(&pdev->dev, indio_dev,
+					      iio_pollfunc_store_time,
+					      odpm_trigger_handler, NULL);
+	if (ret < 0) {
+		pr_err("odpm: Could not setup triggered buffer!\n");
+		odpm_remove(pdev);
+		return ret;
+	}
 	ret = devm_iio_device_register(&pdev->dev, indio_dev);
 	if (ret < 0) {
 		odpm_remove(pdev);
@@ -1935,7 +2083,6 @@ static int odpm_probe(struct platform_device *pdev)
 	if (odpm_info->ws == NULL) {
 		pr_err("odpm: wakelock register fail\n");
 	}
-	mutex_init(&odpm_info->lock);
 
 	pr_info("odpm: %s: init completed\n", pdev->name);
 	smp_store_release(&odpm_info->ready, true);
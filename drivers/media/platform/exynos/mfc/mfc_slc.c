@@ -5,6 +5,8 @@
  *
  */
 
+#include <linux/sizes.h>
+
 #include "mfc_slc.h"
 #include "mfc_rm.h"
 
@@ -137,6 +139,13 @@ void mfc_client_pt_register(struct mfc_core *core)
 			core->ptid[i] = PT_PTID_INVALID;
 			core->curr_slc_pt_idx[i] = MFC_SLC_PARTITION_INVALID;
 		}
+		/* internal buffers get little out of less than 512KB */
+		if (core->num_slc_pt > MFC_SLC_PARTITION_512KB)
+			pt_client_set_size_hint(core->pt_handle, MFC_SLC_PARTITION_512KB,
+					SZ_512K, SZ_512K);
+		if (core->num_slc_pt > MFC_SLC_PARTITION_1MB)
+			pt_client_set_size_hint(core->pt_handle, MFC_SLC_PARTITION_1MB,
+					SZ_512K, SZ_1M);
 		mfc_core_debug(2, "[SLC] PT Client Register success\n");
 	} else {
 		core->pt_handle = NULL;
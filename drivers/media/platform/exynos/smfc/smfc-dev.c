@@ -33,6 +33,9 @@
 #define SMFC_QOS_WAIT 2
 #endif
 
+/* idle time before the H/W and its tables are powered down */
+#define SMFC_AUTOSUSPEND_DELAY_MS 20
+
 static atomic_t smfc_hwfc_state;
 static wait_queue_head_t smfc_hwfc_sync_wq;
 static wait_queue_head_t smfc_suspend_wq;
@@ -106,6 +109,7 @@ static irqreturn_t exynos_smfc_irq_handler(int irq, void *priv)
 		smfc_dump_registers(smfc);
 		state = VB2_BUF_STATE_ERROR;
 		smfc_hwconfigure_reset(smfc);
+		smfc_hwconfigure_invalidate_tables(smfc);
 	}
 
 	if (!IS_ERR(smfc->clk_gate)) {
@@ -115,7 +119,8 @@ static irqreturn_t exynos_smfc_irq_handler(int irq, void *priv)
 	}
 
 	g2d_pm_qos_reset_request(smfc);
-	pm_runtime_put(smfc->dev);
+	pm_runtime_mark_last_busy(smfc->dev);
+	pm_runtime_put_autosuspend(smfc->dev);
 
 	/* ctx is NULL if streamoff is called before (de)compression finishes */
 	if (ctx) {
@@ -183,6 +188,7 @@ static void smfc_timedout_handler(struct timer_list *arg)
 	dev_err(smfc->dev, "=== TIMED-OUT! (1 sec.) =========================");
 	smfc_dump_registers(smfc);
 	smfc_hwconfigure_reset(smfc);
+	smfc_hwconfigure_invalidate_tables(smfc);
 
 	if (!IS_ERR(smfc->clk_gate)) {
 		clk_disable(smfc->clk_gate);
@@ -191,7 +197,8 @@ static void smfc_timedout_handler(struct timer_list *arg)
 	}
 
 	g2d_pm_qos_reset_request(smfc);
-	pm_runtime_put(smfc->dev);
+	pm_runtime_mark_last_busy(smfc->dev);
+	pm_runtime_put_autosuspend(smfc->dev);
 
 	ctx = v4l2_m2m_get_curr_priv(smfc->m2mdev);
 	if (ctx) {
@@ -704,7 +711,8 @@ err_hwfc:
 	}
 err_clk:
 	g2d_pm_qos_reset_request(ctx->smfc);
-	pm_runtime_put(ctx->smfc->dev);
+	pm_runtime_mark_last_busy(ctx->smfc->dev);
+	pm_runtime_put_autosuspend(ctx->smfc->dev);
 err_pm:
 	v4l2_m2m_buf_done(v4l2_m2m_src_buf_remove(ctx->fh.m2m_ctx), VB2_BUF_STATE_ERROR);
 	v4l2_m2m_buf_done(v4l2_m2m_dst_buf_remove(ctx->fh.m2m_ctx), VB2_BUF_STATE_ERROR);
@@ -1010,6 +1018,12 @@ static int exynos_smfc_probe(struct platform_device *pdev)
 		return -ENOMEM;
 
 	smfc->dev = &pdev->dev;
+	smfc_hwconfigure_invalidate_tables(smfc);
+
+	smfc->qtbl_cache = devm_kcalloc(&pdev->dev, SMFC_MAX_QUALITY,
+					sizeof(*smfc->qtbl_cache), GFP_KERNEL);
+	if (!smfc->qtbl_cache)
+		return -ENOMEM;
 
 	dma_set_mask(&pdev->dev, DMA_BIT_MASK(32));
 
@@ -1046,6 +1060,9 @@ static int exynos_smfc_probe(struct platform_device *pdev)
 	}
 
 	INIT_DELAYED_WORK(&smfc->qos_work, smfc_qos_release);
+	/* keep the tables powered between back-to-back jobs */
+	pm_runtime_set_autosuspend_delay(&pdev->dev, SMFC_AUTOSUSPEND_DELAY_MS);
+	pm_runtime_use_autosuspend(&pdev->dev);
 	pm_runtime_enable(&pdev->dev);
 
 #if IS_ENABLED(CONFIG_EXYNOS_BTS)
@@ -1121,6 +1138,8 @@ static int exynos_smfc_remove(struct platform_device *pdev)
 
 	g2d_pm_qos_remove_request(smfc);
 
+	pm_runtime_dont_use_autosuspend(&pdev->dev);
+
 	smfc_deinit_clock(smfc);
 
 	iommu_unregister_device_fault_handler(&pdev->dev);
@@ -1147,8 +1166,10 @@ static int smfc_suspend(struct device *dev)
 	wait_event(smfc_suspend_wq, !(smfc->flags & SMFC_DEV_SUSPENDING));
 
 	/*
-	 * It is guaranteed that the Runtime PM is suspended
-	 * and all relavent clocks are disabled.
+	 * No job is running and all relavent clocks are disabled. The device
+	 * may still be runtime active within its autosuspend delay, so the
+	 * power domain can be turned off without smfc_runtime_suspend() and
+	 * smfc_runtime_resume() being called; see smfc_resume().
 	 */
 
 	return 0;
@@ -1159,6 +1180,9 @@ static int smfc_resume(struct device *dev)
 	struct smfc_dev *smfc = dev_get_drvdata(dev);
 	struct smfc_ctx *ctx = v4l2_m2m_get_curr_priv(smfc->m2mdev);
 
+	/* the tables may have been lost without a runtime PM transition */
+	smfc_hwconfigure_invalidate_tables(smfc);
+
 	/* completing the unfinished job and resuming the next pending jobs */
 	if (ctx)
 		v4l2_m2m_job_finish(smfc->m2mdev, ctx->fh.m2m_ctx);
@@ -1166,6 +1190,27 @@ static int smfc_resume(struct device *dev)
 }
 #endif
 
+#ifdef CONFIG_PM
+static int smfc_runtime_suspend(struct device *dev)
+{
+	return 0;
+}
+
+static int smfc_runtime_resume(struct device *dev)
+{
+	struct smfc_dev *smfc = dev_get_drvdata(dev);
+
+	/*
+	 * the tables do not survive power gating; autosuspend keeps bursts of
+	 * jobs from getting here between every frame
+	 */
+	if (smfc)
+		smfc_hwconfigure_invalidate_tables(smfc);
+
+	return 0;
+}
+#endif
+
 static void exynos_smfc_shutdown(struct platform_device *pdev)
 {
 	struct smfc_dev *smfc = platform_get_drvdata(pdev);
@@ -1180,6 +1225,7 @@ static void exynos_smfc_shutdown(struct platform_device *pdev)
 
 static const struct dev_pm_ops exynos_smfc_pm_ops = {
 	SET_SYSTEM_SLEEP_PM_OPS(smfc_suspend, smfc_resume)
+	SET_RUNTIME_PM_OPS(smfc_runtime_suspend, smfc_runtime_resume, NULL)
 };
 
 static struct platform_driver exynos_smfc_driver = {
@@ -126,13 +126,42 @@ static inline u32 smfc_calc_quantizers(unsigned int idx, unsigned int factor,
 
 #pragma GCC diagnostic pop
 
-static void smfc_hwconfigure_qtable(void __iomem *reg, unsigned int factor,
-				    const u8 table[])
+void smfc_hwconfigure_invalidate_tables(struct smfc_dev *smfc)
+{
+	smfc->hw_tables.main_qfactor = SMFC_HWTBL_INVALID;
+	smfc->hw_tables.sec_qfactor = SMFC_HWTBL_INVALID;
+	smfc->hw_tables.enc_htbl = false;
+}
+
+/* the quantizers for @quality are computed once and reused afterwards */
+static const struct smfc_qtbl_words *smfc_get_quantizers(struct smfc_dev *smfc,
+							  unsigned int quality)
+{
+	struct smfc_qtbl_words *words;
+	unsigned int factor;
+	size_t i;
+
+	quality = clamp(quality, 1U, (unsigned int)SMFC_MAX_QUALITY);
+	words = &smfc->qtbl_cache[quality - 1];
+	if (test_bit(quality, smfc->qtbl_cached))
+		return words;
+
+	factor = (quality < 50) ? 5000 / quality : 200 - quality * 2;
+	for (i = 0; i < SMFC_MCU_SIZE; i += 4) {
+		words->luma[i / 4] = smfc_calc_quantizers(i, factor, default_luma_qtbl);
+		words->chroma[i / 4] = smfc_calc_quantizers(i, factor, default_chroma_qtbl);
+	}
+	set_bit(quality, smfc->qtbl_cached);
+
+	return words;
+}
+
+static void smfc_hwconfigure_qtable(void __iomem *reg, const u32 quants[])
 {
 	size_t i;
 
-	for (i = 0; i < SMFC_MCU_SIZE; i += 4)
-		__raw_writel(smfc_calc_quantizers(i, factor, table), reg + i);
+	for (i = 0; i < SMFC_MCU_SIZE / 4; i++)
+		__raw_writel(quants[i], reg + i * sizeof(u32));
 }
 
 static void smfc_hwconfigure_custom_qtable(void __iomem *reg, const u8 table[])
@@ -150,24 +179,40 @@ static void smfc_hwconfigure_custom_qtable(void __iomem *reg, const u8 table[])
 	}
 }
 
+/*
+ * Tables already in the H/W from the previous compression job with the same
+ * quality factor or custom table are not programmed again.
+ */
 void smfc_hwconfigure_tables(struct smfc_ctx *ctx,
 			     unsigned int qfactor, const u8 qtbl[])
 {
 	size_t i;
-	void __iomem *base = ctx->smfc->reg;
+	struct smfc_dev *smfc = ctx->smfc;
+	struct smfc_hw_tables *hw = &smfc->hw_tables;
+	void __iomem *base = smfc->reg;
 
 	if (qfactor > 0) {
-		qfactor = (qfactor < 50) ? 5000 / qfactor : 200 - qfactor * 2;
-		smfc_hwconfigure_qtable(base + REG_QTBL_BASE,
-					qfactor, default_luma_qtbl);
-		smfc_hwconfigure_qtable(base + REG_QTBL_BASE + SMFC_MCU_SIZE,
-					qfactor, default_chroma_qtbl);
-	} else {
+		if (hw->main_qfactor != (int)qfactor) {
+			const struct smfc_qtbl_words *q = smfc_get_quantizers(smfc, qfactor);
+
+			smfc_hwconfigure_qtable(base + REG_QTBL_BASE, q->luma);
+			smfc_hwconfigure_qtable(base + REG_QTBL_BASE + SMFC_MCU_SIZE,
+						q->chroma);
+			hw->main_qfactor = qfactor;
+		}
+	} else if (hw->main_qfactor != 0 ||
+		   memcmp(hw->main_custom, qtbl, sizeof(hw->main_custom))) {
 		smfc_hwconfigure_custom_qtable(base + REG_QTBL_BASE, qtbl);
 		smfc_hwconfigure_custom_qtable(base + REG_QTBL_BASE + SMFC_MCU_SIZE,
 					       qtbl + SMFC_MCU_SIZE);
+		memcpy(hw->main_custom, qtbl, sizeof(hw->main_custom));
+		hw->main_qfactor = 0;
 	}
 
+	if (hw->enc_htbl)
+		goto select;
+	hw->enc_htbl = true;
+
 	/* Huffman tables */
 	for (i = 0; i < 4; i++) {
 		__raw_writel(ITU_H_TBL_LEN_DC_LUMINANCE[i],
@@ -192,6 +237,7 @@ void smfc_hwconfigure_tables(struct smfc_ctx *ctx,
 		__raw_writel(ITU_H_TBL_VAL_AC_CHROMINANCE[i],
 			     base + REG_HTBL_CHROMA_ACVAL + i * sizeof(u32));
 
+select:
 	__raw_writel(VAL_MAIN_TABLE_SELECT, base + REG_MAIN_TABLE_SELECT);
 	__raw_writel(ctx->img_fmt->v4l2_pixfmt != V4L2_PIX_FMT_GREY ?
 			SMFC_DHT_LEN : SMFC_DHT_GRAY_LEN, base + REG_MAIN_DHT_LEN);
@@ -200,14 +246,17 @@ void smfc_hwconfigure_tables(struct smfc_ctx *ctx,
 void smfc_hwconfigure_2nd_tables(struct smfc_ctx *ctx, unsigned int qfactor)
 {
 	/* Qunatiazation table 2 and 3 will be used by the secondary image */
-	void __iomem *base = ctx->smfc->reg;
+	struct smfc_dev *smfc = ctx->smfc;
+	void __iomem *base = smfc->reg;
 	void __iomem *qtblbase = base + REG_QTBL_BASE + SMFC_MCU_SIZE * 2;
 
-	qfactor = (qfactor < 50) ? 5000 / qfactor : 200 - qfactor * 2;
+	if (smfc->hw_tables.sec_qfactor != (int)qfactor) {
+		const struct smfc_qtbl_words *q = smfc_get_quantizers(smfc, qfactor);
 
-	smfc_hwconfigure_qtable(qtblbase, qfactor, default_luma_qtbl);
-	smfc_hwconfigure_qtable(qtblbase + SMFC_MCU_SIZE,
-				qfactor, default_chroma_qtbl);
+		smfc_hwconfigure_qtable(qtblbase, q->luma);
+		smfc_hwconfigure_qtable(qtblbase + SMFC_MCU_SIZE, q->chroma);
+		smfc->hw_tables.sec_qfactor = qfactor;
+	}
 	/* Huffman table for the secondary image is the same as the main image */
 	__raw_writel(VAL_SEC_TABLE_SELECT, base + REG_SEC_TABLE_SELECT);
 	__raw_writel(ctx->img_fmt->v4l2_pixfmt != V4L2_PIX_FMT_GREY ?
@@ -221,6 +270,9 @@ void smfc_hwconfigure_tables_for_decompression(struct smfc_ctx *ctx)
 	u32 tblsel = ctx->num_components << 16;
 	int i;
 
+	/* the tables of the stream replace what compression has programmed */
+	smfc_hwconfigure_invalidate_tables(ctx->smfc);
+
 	/* Huffman table selector configuration */
 	for (i = 0; i < ctx->num_components; i++) {
 		u32 val = (ctx->huffman_tables->compsel[i].idx_dc |
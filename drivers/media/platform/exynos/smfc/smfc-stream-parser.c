@@ -10,6 +10,8 @@
 #include <linux/kernel.h>
 #include <linux/dma-buf.h>
 #include <linux/slab.h>
+#include <linux/sizes.h>
+#include <linux/uaccess.h>
 
 #include <media/videobuf2-core.h>
 
@@ -38,31 +40,52 @@ static bool smfc_alloc_tables(struct smfc_ctx *ctx)
 	return true;
 }
 
-union jpeg_hword_t {
-	u16 hword;
-	u8 byte[2];
+/*
+ * The header is copied from the user buffer in chunks and parsed from the
+ * kernel copy instead of reading it with get_user() byte by byte.
+ */
+#define SMFC_HDR_CHUNK_SIZE	SZ_4K
+
+struct smfc_hdr_reader {
+	unsigned long start;	/* user address of buf[0] */
+	size_t len;		/* number of valid bytes in buf */
+	unsigned long limit;	/* end of the user buffer */
+	u8 *buf;
 };
 
-static int smfc_get_segment_length(struct smfc_ctx *ctx,
+/* Return @len bytes of the stream at user address @addr, or NULL on fault */
+static const u8 *smfc_hdr_peek(struct smfc_hdr_reader *rd,
+			       unsigned long addr, size_t len)
+{
+	size_t size;
+
+	if (addr >= rd->start && len <= rd->len &&
+	    addr - rd->start <= rd->len - len)
+		return rd->buf + (addr - rd->start);
+
+	if (len > SMFC_HDR_CHUNK_SIZE || addr >= rd->limit || len > rd->limit - addr)
+		return NULL;
+
+	size = min_t(unsigned long, SMFC_HDR_CHUNK_SIZE, rd->limit - addr);
+	size -= copy_from_user(rd->buf, (void __user *)addr, size);
+	rd->start = addr;
+	rd->len = size;
+
+	return (size < len) ? NULL : rd->buf;
+}
+
+static int smfc_get_segment_length(struct smfc_ctx *ctx, struct smfc_hdr_reader *rd,
 				   unsigned long addr, u8 marker, u16 *length)
 {
-	union jpeg_hword_t len;
-	int ret;
+	const u8 *p = smfc_hdr_peek(rd, addr, 2);
 
-	if (IS_ENABLED(CONFIG_CPU_BIG_ENDIAN)) {
-		ret = get_user(len.byte[0], (u16 *)addr++);
-		ret |= get_user(len.byte[1], (u16 *)addr);
-	} else {
-		ret = get_user(len.byte[1], (u16 *)addr++);
-		ret |= get_user(len.byte[0], (u16 *)addr);
-	}
-	if (ret) {
+	if (!p) {
 		dev_err(ctx->smfc->dev,
 			"Failed to read length 0xFF%02X\n", marker);
 		return -EFAULT;
 	}
 
-	*length = len.hword;
+	*length = (p[0] << 8) | p[1];
 
 	return 0;
 }
@@ -92,14 +115,16 @@ unsigned int smfc_get_num_huffval(u8 *hufflen)
 	return num;
 }
 
-static int smfc_parse_dht(struct smfc_ctx *ctx, unsigned long *cursor)
+static int smfc_parse_dht(struct smfc_ctx *ctx, struct smfc_hdr_reader *rd,
+			  unsigned long *cursor)
 {
-	u8 __user *pcursor = (u8 __user *)*cursor;
+	unsigned long pcursor = *cursor;
 	unsigned long segend;
+	const u8 *p;
 	int ret;
 	u16 len;
 
-	ret = smfc_get_segment_length(ctx, *cursor, 0xc4, &len);
+	ret = smfc_get_segment_length(ctx, rd, *cursor, 0xc4, &len);
 	if (ret)
 		return ret;
 
@@ -107,17 +132,19 @@ static int smfc_parse_dht(struct smfc_ctx *ctx, unsigned long *cursor)
 	pcursor += 2;
 
 	/* 17 : TcTh, L1...L16 */
-	while (((unsigned long)pcursor) < (segend - 17)) {
+	while (pcursor < (segend - 17)) {
 		u8 *table;
 		unsigned int num_values;
 		u8 tcth;
 		bool dc;
 
-		ret = get_user(tcth, pcursor++);
-		if (ret) {
+		p = smfc_hdr_peek(rd, pcursor++, 1);
+		if (!p) {
 			dev_err(ctx->smfc->dev, "Failed to read TcTh in DHT\n");
-			return ret;
-		} else if (__halfbytes_larger_than(tcth, 1)) {
+			return -EFAULT;
+		}
+		tcth = *p;
+		if (__halfbytes_larger_than(tcth, 1)) {
 			dev_err(ctx->smfc->dev, "Unsupported TcTh %#x in DHT\n", tcth);
 			return -EINVAL;
 		}
@@ -126,13 +153,14 @@ static int smfc_parse_dht(struct smfc_ctx *ctx, unsigned long *cursor)
 		dc = (((tcth >> 4) & 0xF) == 0);
 		table = dc ? ctx->huffman_tables->dc[tcth & 1].code
 			   : ctx->huffman_tables->ac[tcth & 1].code;
-		ret = copy_from_user(table, pcursor, SMFC_NUM_HCODE);
+		p = smfc_hdr_peek(rd, pcursor, SMFC_NUM_HCODE);
 		pcursor += SMFC_NUM_HCODE;
-		if (ret) {
+		if (!p) {
 			dev_err(ctx->smfc->dev,
 				"Failed to read HUFFLEN of %d,%d\n", tcth >> 4, tcth & 1);
-			return ret;
+			return -EFAULT;
 		}
+		memcpy(table, p, SMFC_NUM_HCODE);
 
 		num_values = smfc_get_num_huffval(table);
 		if ((dc && num_values > SMFC_NUM_DC_HVAL) ||
@@ -143,22 +171,23 @@ static int smfc_parse_dht(struct smfc_ctx *ctx, unsigned long *cursor)
 			return -EINVAL;
 		}
 
-		if (((unsigned long)pcursor + num_values) > segend)
+		if ((pcursor + num_values) > segend)
 			break;
 
 		/* HUFFVAL */
 		table = dc ? ctx->huffman_tables->dc[tcth & 1].value
 			   : ctx->huffman_tables->ac[tcth & 1].value;
-		ret = copy_from_user(table, pcursor, num_values);
+		p = smfc_hdr_peek(rd, pcursor, num_values);
 		pcursor += (unsigned long)num_values;
-		if (ret) {
+		if (!p) {
 			dev_err(ctx->smfc->dev,
 				"Failed to read huffval of %d,%d\n", tcth >> 4, tcth & 1);
 			return -EINVAL;
 		}
+		memcpy(table, p, num_values);
 	}
 
-	if ((*cursor + len) != (unsigned long)pcursor) {
+	if ((*cursor + len) != pcursor) {
 		dev_err(ctx->smfc->dev, "Incorrect DHT length %d\n", len);
 		return -EINVAL;
 	}
@@ -168,14 +197,16 @@ static int smfc_parse_dht(struct smfc_ctx *ctx, unsigned long *cursor)
 	return 0;
 }
 
-static int smfc_parse_dqt(struct smfc_ctx *ctx, unsigned long *cursor)
+static int smfc_parse_dqt(struct smfc_ctx *ctx, struct smfc_hdr_reader *rd,
+			  unsigned long *cursor)
 {
-	u8 __user *pcursor = (u8 __user *)*cursor;
+	unsigned long pcursor = *cursor;
 	unsigned long segend;
+	const u8 *p;
 	int ret;
 	u16 len;
 
-	ret = smfc_get_segment_length(ctx, *cursor, 0xdb, &len);
+	ret = smfc_get_segment_length(ctx, rd, *cursor, 0xdb, &len);
 	if (ret)
 		return ret;
 
@@ -183,25 +214,28 @@ static int smfc_parse_dqt(struct smfc_ctx *ctx, unsigned long *cursor)
 	pcursor += 2;
 
 	/* 17 : TcTh, L1...L16 */
-	while ((unsigned long)pcursor < segend) {
+	while (pcursor < segend) {
 		u8 pqtq;
 
-		ret = get_user(pqtq, pcursor++);
-		if (ret) {
+		p = smfc_hdr_peek(rd, pcursor++, 1);
+		if (!p) {
 			dev_err(ctx->smfc->dev, "Failed to read PqTq in DQT\n");
-			return ret;
-		} else if (pqtq >= SMFC_MAX_QTBL_COUNT) {
+			return -EFAULT;
+		}
+		pqtq = *p;
+		if (pqtq >= SMFC_MAX_QTBL_COUNT) {
 			/* Pq should be 0, Tq should be < 4 */
 			dev_err(ctx->smfc->dev, "Invalid PqTq %02xin DQT\n", pqtq);
 			return -EINVAL;
 		}
 
-		ret = copy_from_user(ctx->quantizer_tables->table[pqtq], pcursor, SMFC_MCU_SIZE);
+		p = smfc_hdr_peek(rd, pcursor, SMFC_MCU_SIZE);
 		pcursor += (unsigned long)SMFC_MCU_SIZE;
-		if (ret) {
+		if (!p) {
 			dev_err(ctx->smfc->dev, "Failed to read %dth Q-Table\n", pqtq);
-			return ret;
+			return -EFAULT;
 		}
+		memcpy(ctx->quantizer_tables->table[pqtq], p, SMFC_MCU_SIZE);
 	}
 
 	*cursor += len;
@@ -210,23 +244,21 @@ static int smfc_parse_dqt(struct smfc_ctx *ctx, unsigned long *cursor)
 }
 
 #define SOF0_LENGTH 17 /* Lf+P+Y+X+Nf+Nf*Comp */
-static int smfc_parse_frameheader(struct smfc_ctx *ctx, unsigned long *cursor)
+static int smfc_parse_frameheader(struct smfc_ctx *ctx, struct smfc_hdr_reader *rd,
+				  unsigned long *cursor)
 {
-	u8 *pos;
-	int i, ret;
-	u8 sof0[SOF0_LENGTH];
-
-	pos = sof0;
+	const u8 *pos;
+	int i;
 
-	ret = copy_from_user(sof0, (void __user *)*cursor, sizeof(sof0));
-	if (ret) {
+	pos = smfc_hdr_peek(rd, *cursor, SOF0_LENGTH);
+	if (!pos) {
 		dev_err(ctx->smfc->dev, "Failed to read SOF0\n");
-		return ret;
+		return -EFAULT;
 	}
 
 	if (__get_u16(pos) != SOF0_LENGTH) {
 		dev_err(ctx->smfc->dev, "Unsupported data in SOF0\n");
-		return ret;
+		return -EINVAL;
 	}
 
 	if (*pos != 8) { /* bits per sample */
@@ -281,26 +313,23 @@ static int smfc_parse_frameheader(struct smfc_ctx *ctx, unsigned long *cursor)
 }
 
 #define SOS_LENGTH 12 /* Ls+Ns+Ns*Comp+Ss+Se+AhAl */
-static int smfc_parse_scanheader(struct smfc_ctx *ctx,
+static int smfc_parse_scanheader(struct smfc_ctx *ctx, struct smfc_hdr_reader *rd,
 				 unsigned long streambase, unsigned long *cursor)
 {
-	u8 *pos;
-	int i, ret;
-	u8 sos[SOS_LENGTH];
-
-	pos = sos;
+	const u8 *pos;
+	int i;
 
 	ctx->offset_of_sos = (unsigned int)(*cursor - streambase - SMFC_JPEG_MARKER_LEN);
 
-	ret = copy_from_user(sos, (void __user *)*cursor, sizeof(sos));
-	if (ret) {
+	pos = smfc_hdr_peek(rd, *cursor, SOS_LENGTH);
+	if (!pos) {
 		dev_err(ctx->smfc->dev, "Failed to read SOS\n");
-		return ret;
+		return -EFAULT;
 	}
 
 	if (__get_u16(pos) != SOS_LENGTH) {
 		dev_err(ctx->smfc->dev, "Unsupported length of SOS segment.\n");
-		return ret;
+		return -EINVAL;
 	}
 
 	if (*pos != 3 && *pos != 1) { /* Ns: number of components */
@@ -342,77 +371,66 @@ static int smfc_parse_scanheader(struct smfc_ctx *ctx,
 	return 0;
 }
 
-int smfc_parse_jpeg_header(struct smfc_ctx *ctx, struct vb2_buffer *vb)
+static int __smfc_parse_jpeg_header(struct smfc_ctx *ctx, struct smfc_hdr_reader *rd,
+				    unsigned long streambase, unsigned long streamend)
 {
 	int ret;
-	union jpeg_hword_t marker;
+	const u8 *marker;
 	u16 len;
-	unsigned long streambase = vb->planes[0].m.userptr;
 	unsigned long cursor = streambase;
-	unsigned long streamend = streambase + vb2_get_plane_payload(vb, 0);
-
-	ctx->num_components = 0;
-
-	if (!smfc_alloc_tables(ctx))
-		return -ENOMEM;
-
-	/* the buffer in vb the entire JPEG stream from SOI */
-
-	/* userptr: get_user/copy_from_user to read stream headers */
-	/* dmabuf: map the buffer in the kernelspace to read stream headers */
 
 	/* SOI */
-	ret = get_user(marker.byte[0], (u16 *)cursor++);
-	ret |= get_user(marker.byte[1], (u16 *)cursor++);
-	if (ret || marker.byte[0] != 0xFF || marker.byte[1] != 0xD8) {
+	marker = smfc_hdr_peek(rd, cursor, SMFC_JPEG_MARKER_LEN);
+	cursor += SMFC_JPEG_MARKER_LEN;
+	if (!marker || marker[0] != 0xFF || marker[1] != 0xD8) {
 		dev_err(ctx->smfc->dev, "SOS maker is not found\n");
 		return -EINVAL;
 	}
 
 	while (cursor < streamend - SMFC_JPEG_MARKER_LEN) {
-		ret = get_user(marker.byte[0], (u16 *)cursor++);
-		ret |= get_user(marker.byte[1], (u16 *)cursor++);
-		if (ret) {
+		marker = smfc_hdr_peek(rd, cursor, SMFC_JPEG_MARKER_LEN);
+		cursor += SMFC_JPEG_MARKER_LEN;
+		if (!marker) {
 			dev_err(ctx->smfc->dev, "Failed to read JPEG maker\n");
 			return -EFAULT;
 		}
 
-		if (marker.byte[0] != 0xFF) {
+		if (marker[0] != 0xFF) {
 			dev_err(ctx->smfc->dev, "Error found in JPEG stream\n");
 			return -EINVAL;
 		}
 
-		switch (marker.byte[1]) {
+		switch (marker[1]) {
 		case 0xC4: /* DHT */
-			ret = smfc_parse_dht(ctx, &cursor);
+			ret = smfc_parse_dht(ctx, rd, &cursor);
 			if (ret)
 				return ret;
 			break;
 		case 0xDB: /* DQT */
-			ret = smfc_parse_dqt(ctx, &cursor);
+			ret = smfc_parse_dqt(ctx, rd, &cursor);
 			if (ret)
 				return ret;
 			break;
 		case 0xC0: /* SOF0 */
-			ret = smfc_parse_frameheader(ctx, &cursor);
+			ret = smfc_parse_frameheader(ctx, rd, &cursor);
 			if (ret)
 				return ret;
 			break;
 		case 0xDA: /**** SOS - THE END OF HEADER PARSING ****/
-			return smfc_parse_scanheader(ctx, streambase, &cursor);
+			return smfc_parse_scanheader(ctx, rd, streambase, &cursor);
 		case 0xD9: /* EOI */
 			dev_err(ctx->smfc->dev,
 				"EOI found during header parsing\n");
 			return -EINVAL;
 		default: /* error checking */
-			if ((marker.byte[1] & 0xF0) == 0xC0) {
+			if ((marker[1] & 0xF0) == 0xC0) {
 				dev_err(ctx->smfc->dev, "Unsupported marker 0xFF%02X found\n",
-					marker.byte[1]);
+					marker[1]);
 				return -EINVAL;
 			}
 
 			/* Ignores all other markers */
-			ret = smfc_get_segment_length(ctx, cursor, marker.byte[1], &len);
+			ret = smfc_get_segment_length(ctx, rd, cursor, marker[1], &len);
 			if (ret)
 				return ret;
 
@@ -424,3 +442,32 @@ int smfc_parse_jpeg_header(struct smfc_ctx *ctx, struct vb2_buffer *vb)
 
 	return -EINVAL;
 }
+
+int smfc_parse_jpeg_header(struct smfc_ctx *ctx, struct vb2_buffer *vb)
+{
+	struct smfc_hdr_reader rd;
+	unsigned long streambase = vb->planes[0].m.userptr;
+	unsigned long streamend = streambase + vb2_get_plane_payload(vb, 0);
+	int ret;
+
+	ctx->num_components = 0;
+
+	if (!smfc_alloc_tables(ctx))
+		return -ENOMEM;
+
+	/* the buffer in vb the entire JPEG stream from SOI */
+
+	/* userptr: copy stream headers in chunks to parse them in the kernel */
+	rd.buf = kmalloc(SMFC_HDR_CHUNK_SIZE, GFP_KERNEL);
+	if (!rd.buf)
+		return -ENOMEM;
+	rd.start = 0;
+	rd.len = 0;
+	rd.limit = streambase + vb->planes[0].length;
+
+	ret = __smfc_parse_jpeg_header(ctx, &rd, streambase, streamend);
+
+	kfree(rd.buf);
+
+	return ret;
+}
@@ -96,6 +96,27 @@ struct smfc_device_data {
 /* Set if HWFC is enabled in device_run, cleared in irq/timeout handler */
 #define SMFC_DEV_OTF_EMUMODE	BIT(4)
 
+#define SMFC_MAX_QUALITY	100
+#define SMFC_HWTBL_INVALID	(-1)
+
+/* quantizers of the default tables for a quality factor, in register order */
+struct smfc_qtbl_words {
+	u32 luma[SMFC_MCU_SIZE / 4];
+	u32 chroma[SMFC_MCU_SIZE / 4];
+};
+
+/*
+ * Tables left in the H/W by the last compression job. A qfactor of 0 means
+ * the custom table in @main_custom, SMFC_HWTBL_INVALID that the content
+ * is unknown.
+ */
+struct smfc_hw_tables {
+	int main_qfactor;
+	int sec_qfactor;
+	bool enc_htbl;
+	u8 main_custom[SMFC_MCU_SIZE * 2];
+};
+
 struct smfc_dev {
 	struct v4l2_device v4l2_dev;
 	struct video_device *videodev;
@@ -124,6 +145,10 @@ struct smfc_dev {
 
 	struct delayed_work qos_work;
 
+	/* only accessed from device_run(), serialized by the m2m framework */
+	struct smfc_hw_tables hw_tables;
+	struct smfc_qtbl_words *qtbl_cache; /* indexed by quality factor - 1 */
+	DECLARE_BITMAP(qtbl_cached, SMFC_MAX_QUALITY + 1);
 };
 
 #define SMFC_CTX_COMPRESS	BIT(0)
@@ -272,6 +297,7 @@ void smfc_hwconfigure_2nd_tables(struct smfc_ctx *ctx, unsigned int qfactor);
 void smfc_hwconfigure_2nd_image(struct smfc_ctx *ctx, bool hwfc_enabled);
 bool smfc_hwstatus_okay(struct smfc_dev *smfc, struct smfc_ctx *ctx);
 void smfc_hwconfigure_reset(struct smfc_dev *smfc);
+void smfc_hwconfigure_invalidate_tables(struct smfc_dev *smfc);
 void smfc_dump_registers(struct smfc_dev *smfc);
 static inline u32 smfc_get_streamsize(struct smfc_dev *smfc)
 {
@@ -73,6 +73,8 @@ struct sscd_device {
 	 * @segs: crash segment data
 	 * @nsegs: number of segments
 	 * @read_offset: read offset within crash data
+	 * @read_seg: segment containing read_offset
+	 * @read_seg_start: offset of read_seg within crash data
 	 */
 	atomic_t                 report_active;
 	u32                      report_flags;
@@ -80,6 +82,8 @@ struct sscd_device {
 	struct sscd_segment      *segs;
 	u16                      nsegs;
 	loff_t                   read_offset;
+	u16                      read_seg;
+	loff_t                   read_seg_start;
 
 	/**
 	 * stats
@@ -149,6 +153,7 @@ static ssize_t sscd_dev_read(struct file *filp, char __user *ubuf, size_t count,
 	struct sscd_device *sdev = filp->private_data;
 	size_t copied = 0;
 	loff_t pos = *f_pos;
+	loff_t seg_start;
 	u16 i;
 
 	if (!count)
@@ -178,28 +183,43 @@ static ssize_t sscd_dev_read(struct file *filp, char __user *ubuf, size_t count,
 		goto out;
 	}
 
-	/* copy the data */
-	for (i = 0; i < sdev->nsegs; i++) {
-		if (pos < (loff_t)sdev->segs[i].size && sdev->segs[i].addr) {
-			ssize_t len = simple_read_from_buffer(ubuf, count, &pos,
-					sdev->segs[i].addr, sdev->segs[i].size);
-			if (len < 0)
-				break;
-
-			count -= len;
-			copied += len;
-			ubuf += len;
-			dev_dbg(&sdev->dev, "seg[%hu] read %zd ", i, len);
+	/* copy the data, resuming from the segment the last read ended in */
+	i = sdev->read_seg;
+	seg_start = sdev->read_seg_start;
+	while (i < sdev->nsegs && count) {
+		struct sscd_segment *seg = &sdev->segs[i];
+		loff_t off = pos - seg_start;
+		ssize_t len;
+
+		if (off >= (loff_t)seg->size) {
+			seg_start += seg->size;
+			i++;
+			continue;
 		}
-		pos -= sdev->segs[i].size;
-		if (pos < 0)
+		/* segment without data, nothing more to stream */
+		if (!seg->addr)
 			break;
+
+		len = simple_read_from_buffer(ubuf, count, &off, seg->addr,
+					      seg->size);
+		if (len <= 0)
+			break;
+
+		count -= len;
+		copied += len;
+		ubuf += len;
+		pos += len;
+		dev_dbg(&sdev->dev, "seg[%hu] read %zd ", i, len);
 	}
+	sdev->read_seg = i;
+	sdev->read_seg_start = seg_start;
 
 out:
 	/* mark request as done only in case of error or EOF condition */
 	if (copied == 0) {
 		*f_pos = 0; /* reset position for new report */
+		sdev->read_seg = 0;
+		sdev->read_seg_start = 0;
 		report_read_completed(sdev);
 	} else {
 		*f_pos += copied;
@@ -417,6 +437,8 @@ static int create_report(struct sscd_device *sdev, struct sscd_segment *segs,
 	sdev->nsegs = count;
 	sdev->crash_hdr.coredump_size = 0;
 	sdev->read_offset = 0;
+	sdev->read_seg = 0;
+	sdev->read_seg_start = 0;
 	sdev->segs = kcalloc(count, sizeof(*segs), GFP_KERNEL);
 	if (!sdev->segs) {
 		rc = -ENOMEM;
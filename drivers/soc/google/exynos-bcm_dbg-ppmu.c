@@ -22,6 +22,8 @@
 #include <linux/bitops.h>
 #include <linux/cpumask.h>
 #include <linux/platform_device.h>
+#include <linux/seqlock.h>
+#include <linux/timekeeping.h>
 
 #if IS_ENABLED(CONFIG_EXYNOS_BCM_DBG_PPMU)
 
@@ -52,6 +54,9 @@
 /* size of bitmap which should include 'cycles' counter */
 #define PPMU_CNT_MASK_SIZE  32
 
+/* number of counter snapshots kept by the driver */
+#define PPMU_NUM_SNAPSHOT  2
+
 struct ppmu_hw_config {
 	struct perf_event		*events[PPMU_NUM_CNT];
 	DECLARE_BITMAP(used_mask, PPMU_CNT_MASK_SIZE);
@@ -79,23 +84,39 @@ struct ppmu_dump_format {
 	struct exynos_bcm_accumulator_data	data;
 };
 
+/*
+ * struct ppmu_snapshot - Copy of the accumulators of all PPMUs
+ *
+ * @seq			: Detects a reader racing with a refresh of this copy
+ * @acc			: Accumulator data, indexed by PPMU IP index
+ */
+struct ppmu_snapshot {
+	seqcount_raw_spinlock_t			seq;
+	struct exynos_bcm_accumulator_data	*acc;
+};
+
 /*
  * struct ppmu_debug_core - Debug core controls all PPMUs
  *
  * @enabled		: debug core is enabled
  * @cpu			: cpu which has perf events actually
  * @events		: number of enabled events (in all PPMUs)
- * @active		: number of active events (in all PPMUs)
- * @read		: number of events read in this cycle (in all PPMUs)
+ * @snap_lock		: Serializes refreshes of the counter snapshots
+ * @snap		: Double-buffered counter snapshots
+ * @snap_cur		: Index of the latest snapshot in @snap
+ * @snap_expires	: ktime (ns) after which the latest snapshot is stale
  *
  * The debug core is to control and measure counters in PPMUs.
  * The @events keeps number of enabled events (by perf_event_open syscall)
  * so that it can turn off the debug core after all the events are gone.
  *
- * The @active and @read are to refresh counter values (i.e. dump the current
- * counters from PPMUs) in a batch to avoid unnecessary communications with
- * debug core.  Note that @active and @events can be different because of
- * multiplexing in the perf_event core (maybe due to hardware restriction).
+ * Counter values are read from a snapshot of the accumulators rather than
+ * from the dump area directly.  The debug core only updates accumulators
+ * once every PPMU_TIMER_PERIOD, so a snapshot is refreshed (i.e. the current
+ * counters are dumped from PPMUs with an IPC) at most once per period, by
+ * whichever reader first finds it stale.  The refresh fills the older copy
+ * and then publishes it, so readers never wait for the IPC and all events
+ * read in the same period see the same dump.
  *
  * The @cpu tells which cpu is currently in charge of accessing PPMU (through
  * the debug core).  Since it's a global resource, we only need a single cpu
@@ -110,8 +131,10 @@ struct ppmu_debug_core {
 	bool				enabled;
 	int				cpu;
 	int				events;
-	atomic_t			active;
-	atomic_t			read;
+	raw_spinlock_t			snap_lock;
+	struct ppmu_snapshot		snap[PPMU_NUM_SNAPSHOT];
+	unsigned int			snap_cur;
+	u64				snap_expires;
 };
 
 static struct ppmu_debug_core *ppmu_dbg_core;
@@ -357,22 +380,25 @@ static int platform_pmu_get_event_idx(struct ppmu_hw_config *hw_config,
 static inline u64 platform_pmu_read_counter(struct perf_event *event)
 {
 	struct platform_pmu *ppmu = to_platform_pmu(event->pmu);
-	struct ppmu_dump_format *dump_base;
+	struct exynos_bcm_accumulator_data *acc;
+	struct ppmu_snapshot *snap;
+	unsigned int seq;
 	u64 val;
 
 	if (!platform_pmu_counter_valid(event->hw.idx))
 		return 0;
 
-	if (ppmu_dbg_core->data->dump_addr.p_addr == 0)
-		return 0;
-
-	dump_base = (void *)(ppmu_dbg_core->data->dump_addr.v_addr +
-			     EXYNOS_BCM_KTIME_SIZE);
+	/* pairs with smp_store_release() in platform_pmu_refresh_snapshot() */
+	snap = &ppmu_dbg_core->snap[smp_load_acquire(&ppmu_dbg_core->snap_cur)];
+	acc = &snap->acc[ppmu->ip_index];
 
-	if (event->hw.idx == PPMU_CYCLES_IDX)
-		val = dump_base[ppmu->ip_index].data.ccnt;
-	else
-		val = dump_base[ppmu->ip_index].data.pmcnt[event->hw.idx];
+	do {
+		seq = read_seqcount_begin(&snap->seq);
+		if (event->hw.idx == PPMU_CYCLES_IDX)
+			val = acc->ccnt;
+		else
+			val = acc->pmcnt[event->hw.idx];
+	} while (read_seqcount_retry(&snap->seq, seq));
 
 	return val;
 }
@@ -391,6 +417,9 @@ static void platform_pmu_run_control(unsigned enable)
 	exynos_bcm_dbg_run_ctrl(&ipc_base_info, &enable, ppmu_dbg_core->data);
 
 	ppmu_dbg_core->enabled = enable;
+
+	/* accumulators restart, don't keep using the old counter values */
+	WRITE_ONCE(ppmu_dbg_core->snap_expires, 0);
 }
 
 static void platform_pmu_mode_control(unsigned mode)
@@ -482,6 +511,49 @@ static void platform_pmu_dump_control(void)
 					      ppmu_dbg_core->data);
 }
 
+static void platform_pmu_refresh_snapshot(void)
+{
+	struct exynos_bcm_dbg_data *data = ppmu_dbg_core->data;
+	struct ppmu_dump_format *dump_base;
+	struct ppmu_snapshot *snap;
+	unsigned long flags;
+	unsigned int next;
+	u64 now;
+	int i;
+
+	if (ktime_get_ns() < READ_ONCE(ppmu_dbg_core->snap_expires))
+		return;
+
+	/* someone else is refreshing, just use the current snapshot */
+	if (!raw_spin_trylock_irqsave(&ppmu_dbg_core->snap_lock, flags))
+		return;
+
+	now = ktime_get_ns();
+	if (now < ppmu_dbg_core->snap_expires)
+		goto out;
+
+	if (data->dump_addr.p_addr == 0)
+		goto out;
+
+	platform_pmu_dump_control();
+
+	dump_base = (void *)(data->dump_addr.v_addr + EXYNOS_BCM_KTIME_SIZE);
+	next = (ppmu_dbg_core->snap_cur + 1) % PPMU_NUM_SNAPSHOT;
+	snap = &ppmu_dbg_core->snap[next];
+
+	write_seqcount_begin(&snap->seq);
+	for (i = 0; i < data->bcm_ip_nr; i++)
+		snap->acc[i] = dump_base[i].data;
+	write_seqcount_end(&snap->seq);
+
+	/* pairs with smp_load_acquire() in platform_pmu_read_counter() */
+	smp_store_release(&ppmu_dbg_core->snap_cur, next);
+	WRITE_ONCE(ppmu_dbg_core->snap_expires,
+		   now + PPMU_TIMER_PERIOD * NSEC_PER_USEC);
+out:
+	raw_spin_unlock_irqrestore(&ppmu_dbg_core->snap_lock, flags);
+}
+
 static void platform_pmu_reset(void)
 {
 	int i;
@@ -540,18 +612,8 @@ static void platform_pmu_set_event_period(struct perf_event *event)
  */
 static void platform_pmu_read(struct perf_event *event)
 {
-	int read_count = atomic_inc_return(&ppmu_dbg_core->read);
-
-	/* update counter values for first event read */
-	if (read_count == 1)
-		platform_pmu_dump_control();
-
-	/*
-	 * after reading all events, we should fetch new counter values
-	 * from debug core again.  So reset the 'read' count.
-	 */
-	if (read_count >= atomic_read(&ppmu_dbg_core->active))
-		atomic_set(&ppmu_dbg_core->read, 0);
+	/* fetch new counter values from debug core once per period */
+	platform_pmu_refresh_snapshot();
 
 	platform_pmu_update_counter(event);
 }
@@ -584,7 +646,6 @@ static int platform_pmu_add(struct perf_event *event, int evflags)
 		return idx;
 	}
 
-	atomic_inc(&ppmu_dbg_core->active);
 	ppmu->active++;
 	hwc->idx = idx;
 
@@ -613,7 +674,6 @@ static void platform_pmu_del(struct perf_event *event, int evflags)
 	platform_pmu_stop(event, PERF_EF_UPDATE);
 
 	raw_spin_lock_irqsave(&ppmu->pmu_lock, flags);
-	atomic_dec(&ppmu_dbg_core->active);
 	ppmu->active--;
 
 	if (idx < PPMU_NUM_CNT)
@@ -809,6 +869,8 @@ static int platform_pmu_cpu_online(unsigned int cpu)
 static int platform_pmu_probe_pmu(struct platform_device *pdev)
 {
 	size_t ppmu_ptr_sz = sizeof(*ppmu_dbg_core->ppmu);
+	struct ppmu_snapshot *snap;
+	int i;
 
 	ppmu_dbg_core = devm_kzalloc(&pdev->dev, sizeof(*ppmu_dbg_core),
 				     GFP_KERNEL);
@@ -824,8 +886,15 @@ static int platform_pmu_probe_pmu(struct platform_device *pdev)
 	if (ppmu_dbg_core->ppmu == NULL)
 		return -ENOMEM;
 
-	atomic_set(&ppmu_dbg_core->active, 0);
-	atomic_set(&ppmu_dbg_core->read, 0);
+	raw_spin_lock_init(&ppmu_dbg_core->snap_lock);
+	for (i = 0; i < PPMU_NUM_SNAPSHOT; i++) {
+		snap = &ppmu_dbg_core->snap[i];
+		seqcount_raw_spinlock_init(&snap->seq, &ppmu_dbg_core->snap_lock);
+		snap->acc = devm_kcalloc(&pdev->dev, ppmu_dbg_core->data->bcm_ip_nr,
+					 sizeof(*snap->acc), GFP_KERNEL);
+		if (snap->acc == NULL)
+			return -ENOMEM;
+	}
 
 	return 0;
 }
@@ -932,6 +1001,8 @@ void exynos_bcm_dbg_ppmu_exit(struct platform_device *pdev)
 		platform_pmu_free(ppmu_dbg_core->ppmu[i]);
 	}
 
+	for (i = 0; i < PPMU_NUM_SNAPSHOT; i++)
+		devm_kfree(ppmu_dbg_core->dev, ppmu_dbg_core->snap[i].acc);
 	devm_kfree(ppmu_dbg_core->dev, ppmu_dbg_core->ppmu);
 	devm_kfree(ppmu_dbg_core->dev, ppmu_dbg_core);
 	ppmu_dbg_core = NULL;
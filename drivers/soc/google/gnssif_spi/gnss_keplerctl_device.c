@@ -126,6 +126,8 @@ static int init_ctl_device(struct gnss_ctl *gc, struct gnss_pdata *pdata)
 	gpio_set_value(gc->gpio_ap2gnss_spi.num, 0);
 
 	init_completion(&gc->gnss_rdy_cmpl);
+	init_completion(&gc->tx_done_cmpl);
+	complete_all(&gc->tx_done_cmpl);
 
 	atomic_set(&gc->wait_rdy, 0);
 	atomic_set(&gc->tx_in_progress, 0);
@@ -89,22 +89,27 @@ static void rx_work(struct work_struct *ws)
 		if (!skb) {
 			gc->ops.gnss_send_betp_int(gc, 1);
 			if (atomic_read(&gc->tx_in_progress) == 0) {
-				udelay(100);
+				usleep_range(100, 150);
 				gc->ops.gnss_send_betp_int(gc, 0);
 			}
 
-			skb = alloc_skb(max_len, GFP_KERNEL);
+			skb = ld->rx_skb;
+			ld->rx_skb = NULL;
+			if (!skb)
+				skb = alloc_skb(max_len, GFP_KERNEL);
 			if (!skb) {
 				gif_err("%s: ERR! rx alloc_skb fail (msg size:%u)\n",
 						iod->name, len);
 				goto exit;
 			}
 		}
+		/* chunks land directly in the skb handed to the io device */
 		buff = skb_put(skb, len);
 		ret = gnss_spi_recv(buff, len);
 		if (ret) {
 			gif_err("gnss_spi_recv() error:%d\n", ret);
-			dev_kfree_skb_any(skb);
+			skb_trim(skb, 0);
+			ld->rx_skb = skb;
 			goto exit;
 		}
 
@@ -120,8 +125,11 @@ static void rx_work(struct work_struct *ws)
 			if (atomic_read(&gc->wait_rdy) == 1) {
 				atomic_set(&gc->wait_rdy, 0);
 				complete_all(&gc->gnss_rdy_cmpl);
-				while (atomic_read(&gc->tx_in_progress) == 1)
-					udelay(10);
+				if (atomic_read(&gc->tx_in_progress) == 1 &&
+				    !wait_for_completion_timeout(&gc->tx_done_cmpl,
+								 GNSS_RDY_TIMEOUT))
+					gif_err("TIMEOUT(%lu): tx to kepler not finished\n",
+						GNSS_RDY_TIMEOUT);
 			}
 		}
 	} while (gc->ops.gnss_spi_status(gc));
@@ -162,6 +170,7 @@ static int send_betp(struct link_device *ld, struct io_device *iod, char *buff,
 	}
 	skb_put(skb, size);
 
+	reinit_completion(&gc->tx_done_cmpl);
 	atomic_set(&gc->tx_in_progress, 1);
 
 	reinit_completion(&gc->gnss_rdy_cmpl);
@@ -193,6 +202,7 @@ static int send_betp(struct link_device *ld, struct io_device *iod, char *buff,
 exit:
 	atomic_set(&gc->wait_rdy, 0);
 	atomic_set(&gc->tx_in_progress, 0);
+	complete_all(&gc->tx_done_cmpl);
 	gc->ops.gnss_send_betp_int(gc, 0);
 
 	gif_enable_irq(&gc->irq_gnss2ap_spi);
@@ -200,6 +210,24 @@ exit:
 	return ret;
 }
 
+static void link_device_release(void *data)
+{
+	struct link_device *ld = data;
+
+	cancel_delayed_work_sync(&ld->rx_dwork);
+	destroy_workqueue(ld->rx_wq);
+
+	/* partial batch left behind by a failed receive */
+	dev_kfree_skb_any(ld->rx_skb);
+	ld->rx_skb = NULL;
+}
+
+void destroy_link_device(struct platform_device *pdev, struct link_device *ld)
+{
+	devm_release_action(&pdev->dev, link_device_release, ld);
+	devm_kfree(&pdev->dev, ld);
+}
+
 struct link_device *create_link_device(struct platform_device *pdev)
 {
 	struct link_device *ld = NULL;
@@ -224,18 +252,25 @@ struct link_device *create_link_device(struct platform_device *pdev)
 	ld->name = "GNSS_LINK_DEVICE";
 	ld->send = send_betp;
 	ld->spi_rx_size = DEFAULT_SPI_RX_SIZE;
+	ld->max_spi_rx_size = MAX_SPI_RX_SIZE;
 	ld->spi_tx_size = DEFAULT_SPI_TX_SIZE;
 
 	ld->rx_wq = alloc_workqueue("gnss_spi_wq",
 					__WQ_LEGACY | WQ_MEM_RECLAIM | WQ_UNBOUND | WQ_HIGHPRI, 1);
 	if (!ld->rx_wq) {
 		gif_err("alloc_workqueue() error\n");
-		goto exit;
+		devm_kfree(dev, ld);
+		return NULL;
 	}
 	INIT_DELAYED_WORK(&ld->rx_dwork, rx_work);
 
+	if (devm_add_action_or_reset(dev, link_device_release, ld)) {
+		gif_err("ERR! devm_add_action_or_reset() fail\n");
+		devm_kfree(dev, ld);
+		return NULL;
+	}
+
 	gif_info("---\n");
 
-exit:
 	return ld;
 }
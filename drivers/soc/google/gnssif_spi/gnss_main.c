@@ -239,7 +239,7 @@ static int gnss_probe(struct platform_device *pdev)
 	return 0;
 
 free_ld:
-	devm_kfree(dev, ld);
+	destroy_link_device(pdev, ld);
 free_gc:
 	devm_kfree(dev, gc);
 probe_fail:
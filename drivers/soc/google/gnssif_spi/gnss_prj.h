@@ -43,6 +43,8 @@ struct link_device {
 	unsigned int spi_tx_size;
 	struct workqueue_struct *rx_wq;
 	struct delayed_work rx_dwork;
+	/* rx skb kept for the next batch, only touched by rx_work() */
+	struct sk_buff *rx_skb;
 
 	int (*send)(struct link_device *ld, struct io_device *iod, char *buff,
 			unsigned int size);
@@ -61,6 +63,7 @@ struct gnss_ctl {
 	struct gnssctl_ops ops;
 	struct io_device *iod;
 	struct completion gnss_rdy_cmpl;
+	struct completion tx_done_cmpl;
 	struct gnss_irq irq_gnss2ap_spi;
 	struct gnss_gpio gpio_gnss2ap_spi;
 	struct gnss_gpio gpio_ap2gnss_spi;
@@ -72,6 +75,7 @@ struct gnss_ctl {
 
 struct gnss_ctl *create_ctl_device(struct platform_device *pdev);
 struct link_device *create_link_device(struct platform_device *pdev);
+void destroy_link_device(struct platform_device *pdev, struct link_device *ld);
 struct io_device *create_io_device(struct platform_device *pdev,
 		struct link_device *ld, struct gnss_ctl *gc, struct gnss_pdata *pdata);
 
@@ -40,16 +40,10 @@ EXPORT_SYMBOL(gnss_spi_send);
 int gnss_spi_recv(char *buff, unsigned int size)
 {
 	int ret = 0;
-	struct spi_message msg;
-	struct spi_transfer rx;
 
-	memset(&rx, 0, sizeof(struct spi_transfer));
-	rx.len = size;
-	rx.rx_buf = buff;
-	rx.bits_per_word = SPI_BITS_PER_WORD;
-	spi_message_init(&msg);
-	spi_message_add_tail(&rx, &msg);
-	ret = spi_sync(gnss_if.spi, &msg);
+	gnss_if.rx_xfer.len = size;
+	gnss_if.rx_xfer.rx_buf = buff;
+	ret = spi_sync(gnss_if.spi, &gnss_if.rx_msg);
 	if (ret < 0)
 		gif_err("spi_sync() error:%d\n", ret);
 
@@ -72,6 +66,11 @@ static int gnss_spi_probe(struct spi_device *spi)
 	}
 	spi_set_drvdata(spi, &gnss_if);
 	gnss_if.spi = spi;
+
+	memset(&gnss_if.rx_xfer, 0, sizeof(struct spi_transfer));
+	gnss_if.rx_xfer.bits_per_word = SPI_BITS_PER_WORD;
+	spi_message_init(&gnss_if.rx_msg);
+	spi_message_add_tail(&gnss_if.rx_xfer, &gnss_if.rx_msg);
 	gif_info("---\n");
 
 	return 0;
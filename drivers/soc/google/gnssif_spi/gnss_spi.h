@@ -18,6 +18,9 @@
 struct gnss_spi {
 	struct spi_device *spi;
 	struct mutex lock;
+	/* prebuilt rx message, rx_work() is the only receiver */
+	struct spi_message rx_msg;
+	struct spi_transfer rx_xfer;
 };
 
 static struct gnss_spi gnss_if;
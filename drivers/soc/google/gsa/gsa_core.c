@@ -15,6 +15,7 @@
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
+#include <linux/wait.h>
 #include <linux/gsa.h>
 #include <linux/gsa/gsa_aoc.h>
 #include <linux/gsa/gsa_dsp.h>
@@ -30,6 +31,9 @@
 
 #define MAX_DEVICES 1
 
+/* Number of bounce buffers, each PAGE_SIZE */
+#define GSA_BB_NUM 4
+
 static struct class *gsa_cdev_class;
 static dev_t gsa_cdev_base_num;
 static DEFINE_IDR(gsa_cdev_devices);
@@ -40,13 +44,19 @@ struct gsa_cdev {
 	struct device *device;
 };
 
+struct gsa_bb {
+	dma_addr_t da;
+	void *va;
+};
+
 struct gsa_dev_state {
 	struct device *dev;
 	struct gsa_mbox *mb;
-	dma_addr_t bb_da;
-	void *bb_va;
+	struct gsa_bb bb[GSA_BB_NUM];
 	size_t bb_sz;
-	struct mutex bb_lock; /* protects access to bounce buffer */
+	unsigned long bb_free; /* bitmap of free bounce buffers */
+	spinlock_t bb_lock; /* protects bb_free */
+	wait_queue_head_t bb_wq; /* waiters for a free bounce buffer */
 	struct gsa_tz_chan_ctx aoc_srv;
 	struct gsa_tz_chan_ctx tpu_srv;
 	struct gsa_tz_chan_ctx dsp_srv;
@@ -254,11 +264,46 @@ int gsa_send_dsp_cmd(struct device *gsa, enum gsa_dsp_cmd arg)
 EXPORT_SYMBOL_GPL(gsa_send_dsp_cmd);
 
 
+/*
+ *  Bounce buffer pool
+ */
+static struct gsa_bb *gsa_bb_try_get(struct gsa_dev_state *s)
+{
+	struct gsa_bb *bb = NULL;
+
+	spin_lock(&s->bb_lock);
+	if (s->bb_free) {
+		unsigned long i = __ffs(s->bb_free);
+
+		__clear_bit(i, &s->bb_free);
+		bb = &s->bb[i];
+	}
+	spin_unlock(&s->bb_lock);
+
+	return bb;
+}
+
+static struct gsa_bb *gsa_bb_get(struct gsa_dev_state *s)
+{
+	struct gsa_bb *bb;
+
+	wait_event(s->bb_wq, (bb = gsa_bb_try_get(s)));
+	return bb;
+}
+
+static void gsa_bb_put(struct gsa_dev_state *s, struct gsa_bb *bb)
+{
+	spin_lock(&s->bb_lock);
+	__set_bit(bb - s->bb, &s->bb_free);
+	spin_unlock(&s->bb_lock);
+	wake_up(&s->bb_wq);
+}
+
 /*
  *  External KDN interface
  */
-static int send_kdn_cmd(struct gsa_dev_state *s, u32 cmd,
-			void *dst_buf, size_t dst_buf_sz, u32 opts,
+static int send_kdn_cmd(struct gsa_dev_state *s, struct gsa_bb *bb,
+			u32 cmd, void *dst_buf, size_t dst_buf_sz, u32 opts,
 			const void *src_data, size_t src_data_len)
 {
 	int ret;
@@ -289,12 +334,12 @@ static int send_kdn_cmd(struct gsa_dev_state *s, u32 cmd,
 			return -EINVAL;
 		}
 
-		memcpy(s->bb_va, src_data, src_data_len);
+		memcpy(bb->va, src_data, src_data_len);
 	}
 
 	/* Invoke KDN command */
-	req[KDN_DATA_BUF_ADDR_LO_IDX] = (u32)s->bb_da;
-	req[KDN_DATA_BUF_ADDR_HI_IDX] = (u32)(s->bb_da >> 32);
+	req[KDN_DATA_BUF_ADDR_LO_IDX] = (u32)bb->da;
+	req[KDN_DATA_BUF_ADDR_HI_IDX] = (u32)(bb->da >> 32);
 	req[KDN_DATA_BUF_SIZE_IDX] = max_t(u32, dst_buf_sz, src_data_len);
 	req[KDN_DATA_LEN_IDX] = (u32)src_data_len;
 	req[KDN_OPTION_IDX] = opts;
@@ -321,7 +366,7 @@ static int send_kdn_cmd(struct gsa_dev_state *s, u32 cmd,
 
 	if (cb) {
 		/* copy data to destination buffer */
-		memcpy(dst_buf, s->bb_va, cb);
+		memcpy(dst_buf, bb->va, cb);
 	}
 
 	return cb;
@@ -331,13 +376,14 @@ int gsa_kdn_derive_raw_secret(struct device *gsa, void *buf, size_t buf_sz,
 			      const void *key_blob, size_t key_blob_len)
 {
 	int ret;
+	struct gsa_bb *bb;
 	struct platform_device *pdev = to_platform_device(gsa);
 	struct gsa_dev_state *s = platform_get_drvdata(pdev);
 
-	mutex_lock(&s->bb_lock);
-	ret = send_kdn_cmd(s, GSA_MB_CMD_KDN_DERIVE_RAW_SECRET,
+	bb = gsa_bb_get(s);
+	ret = send_kdn_cmd(s, bb, GSA_MB_CMD_KDN_DERIVE_RAW_SECRET,
 			   buf, buf_sz, 0, key_blob, key_blob_len);
-	mutex_unlock(&s->bb_lock);
+	gsa_bb_put(s, bb);
 
 	return ret;
 }
@@ -347,13 +393,14 @@ int gsa_kdn_program_key(struct device *gsa, u32 slot, const void *key_blob,
 			size_t key_blob_len)
 {
 	int ret;
+	struct gsa_bb *bb;
 	struct platform_device *pdev = to_platform_device(gsa);
 	struct gsa_dev_state *s = platform_get_drvdata(pdev);
 
-	mutex_lock(&s->bb_lock);
-	ret = send_kdn_cmd(s, GSA_MB_CMD_KDN_PROGRAM_KEY,
+	bb = gsa_bb_get(s);
+	ret = send_kdn_cmd(s, bb, GSA_MB_CMD_KDN_PROGRAM_KEY,
 			   NULL, 0, slot, key_blob, key_blob_len);
-	mutex_unlock(&s->bb_lock);
+	gsa_bb_put(s, bb);
 
 	return ret;
 }
@@ -395,7 +442,8 @@ EXPORT_SYMBOL_GPL(gsa_kdn_set_operating_mode);
 /*
  *   External SJTAG management interface
  */
-static int send_sjtag_data_cmd(struct gsa_dev_state *s, u32 cmd,
+static int send_sjtag_data_cmd(struct gsa_dev_state *s, struct gsa_bb *bb,
+			       u32 cmd,
 			       void *dst_buf, size_t dst_buf_sz,
 			       const void *src_data, size_t src_data_len,
 			       u32 *status)
@@ -428,12 +476,12 @@ static int send_sjtag_data_cmd(struct gsa_dev_state *s, u32 cmd,
 			return -EINVAL;
 		}
 
-		memcpy(s->bb_va, src_data, src_data_len);
+		memcpy(bb->va, src_data, src_data_len);
 	}
 
 	/* Invoke SJTAG command */
-	req[SJTAG_DATA_BUF_ADDR_LO_IDX] = (u32)s->bb_da;
-	req[SJTAG_DATA_BUF_ADDR_HI_IDX] = (u32)(s->bb_da >> 32);
+	req[SJTAG_DATA_BUF_ADDR_LO_IDX] = (u32)bb->da;
+	req[SJTAG_DATA_BUF_ADDR_HI_IDX] = (u32)(bb->da >> 32);
 	req[SJTAG_DATA_BUF_SIZE_IDX] = max_t(u32, dst_buf_sz, src_data_len);
 	req[SJTAG_DATA_LEN_IDX] = (u32)src_data_len;
 
@@ -463,7 +511,7 @@ static int send_sjtag_data_cmd(struct gsa_dev_state *s, u32 cmd,
 
 	if (cb) {
 		/* copy data to destination buffer */
-		memcpy(dst_buf, s->bb_va, cb);
+		memcpy(dst_buf, bb->va, cb);
 	}
 
 	return cb;
@@ -522,16 +570,17 @@ int gsa_sjtag_get_pub_key_hash(struct device *gsa, void *hash, size_t size,
 			       u32 *status)
 {
 	int ret;
+	struct gsa_bb *bb;
 	struct gsa_dev_state *s;
 	struct platform_device *pdev;
 
 	pdev = to_platform_device(gsa);
 	s = platform_get_drvdata(pdev);
 
-	mutex_lock(&s->bb_lock);
-	ret = send_sjtag_data_cmd(s, GSA_MB_CMD_SJTAG_GET_PUB_KEY_HASH,
+	bb = gsa_bb_get(s);
+	ret = send_sjtag_data_cmd(s, bb, GSA_MB_CMD_SJTAG_GET_PUB_KEY_HASH,
 				  hash, size, NULL, 0, status);
-	mutex_unlock(&s->bb_lock);
+	gsa_bb_put(s, bb);
 
 	return ret;
 }
@@ -541,16 +590,17 @@ int gsa_sjtag_set_pub_key(struct device *gsa, const void *key, size_t size,
 			  u32 *status)
 {
 	int ret;
+	struct gsa_bb *bb;
 	struct gsa_dev_state *s;
 	struct platform_device *pdev;
 
 	pdev = to_platform_device(gsa);
 	s = platform_get_drvdata(pdev);
 
-	mutex_lock(&s->bb_lock);
-	ret = send_sjtag_data_cmd(s, GSA_MB_CMD_SJTAG_SET_PUB_KEY,
+	bb = gsa_bb_get(s);
+	ret = send_sjtag_data_cmd(s, bb, GSA_MB_CMD_SJTAG_SET_PUB_KEY,
 				  NULL, 0, key, size, status);
-	mutex_unlock(&s->bb_lock);
+	gsa_bb_put(s, bb);
 
 	return ret;
 }
@@ -560,16 +610,17 @@ int gsa_sjtag_get_challenge(struct device *gsa, void *challenge, size_t size,
 			    u32 *status)
 {
 	int ret;
+	struct gsa_bb *bb;
 	struct gsa_dev_state *s;
 	struct platform_device *pdev;
 
 	pdev = to_platform_device(gsa);
 	s = platform_get_drvdata(pdev);
 
-	mutex_lock(&s->bb_lock);
-	ret = send_sjtag_data_cmd(s, GSA_MB_CMD_SJTAG_GET_CHALLENGE,
+	bb = gsa_bb_get(s);
+	ret = send_sjtag_data_cmd(s, bb, GSA_MB_CMD_SJTAG_GET_CHALLENGE,
 				  challenge, size, NULL, 0, status);
-	mutex_unlock(&s->bb_lock);
+	gsa_bb_put(s, bb);
 
 	return ret;
 }
@@ -580,16 +631,17 @@ int gsa_sjtag_send_srv_response(struct device *gsa,
 				u32 *status)
 {
 	int ret;
+	struct gsa_bb *bb;
 	struct gsa_dev_state *s;
 	struct platform_device *pdev;
 
 	pdev = to_platform_device(gsa);
 	s = platform_get_drvdata(pdev);
 
-	mutex_lock(&s->bb_lock);
-	ret = send_sjtag_data_cmd(s, GSA_MB_CMD_SJTAG_ENABLE,
+	bb = gsa_bb_get(s);
+	ret = send_sjtag_data_cmd(s, bb, GSA_MB_CMD_SJTAG_ENABLE,
 				  NULL, 0, rsp, size, status);
-	mutex_unlock(&s->bb_lock);
+	gsa_bb_put(s, bb);
 
 	return ret;
 }
@@ -808,7 +860,10 @@ ATTRIBUTE_GROUPS(gsa);
 
 static int gsa_probe(struct platform_device *pdev)
 {
+	int i;
 	int err;
+	void *bb_va;
+	dma_addr_t bb_da;
 	struct gsa_dev_state *s;
 	struct device *dev = &pdev->dev;
 
@@ -817,7 +872,8 @@ static int gsa_probe(struct platform_device *pdev)
 		return -ENOMEM;
 
 	s->dev = dev;
-	mutex_init(&s->bb_lock);
+	spin_lock_init(&s->bb_lock);
+	init_waitqueue_head(&s->bb_wq);
 	platform_set_drvdata(pdev, s);
 
 	/*
@@ -841,11 +897,17 @@ static int gsa_probe(struct platform_device *pdev)
 		return err;
 	}
 
-	/* alloc bounce buffer */
-	s->bb_va = dmam_alloc_coherent(dev, PAGE_SIZE, &s->bb_da, GFP_KERNEL);
-	if (!s->bb_va)
+	/* alloc bounce buffers */
+	bb_va = dmam_alloc_coherent(dev, GSA_BB_NUM * PAGE_SIZE, &bb_da,
+				    GFP_KERNEL);
+	if (!bb_va)
 		return -ENOMEM;
+	for (i = 0; i < GSA_BB_NUM; i++) {
+		s->bb[i].va = bb_va + i * PAGE_SIZE;
+		s->bb[i].da = bb_da + i * PAGE_SIZE;
+	}
 	s->bb_sz = PAGE_SIZE;
+	s->bb_free = GENMASK(GSA_BB_NUM - 1, 0);
 
 	/* Initialize TZ serice link to HWMGR */
 	gsa_tz_chan_ctx_init(&s->aoc_srv, HWMGR_AOC_PORT, dev);
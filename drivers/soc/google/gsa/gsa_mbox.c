@@ -11,6 +11,7 @@
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #if IS_ENABLED(CONFIG_GSA_PKVM)
 #include <linux/pm_runtime.h>
@@ -86,6 +87,9 @@ struct gsa_mbox {
 	spinlock_t slock; /* protects RMW like access to some registers */
 	struct mutex mbox_lock; /* protects access to SRs */
 	struct completion mbox_cmd_completion;
+	spinlock_t queue_lock; /* protects cmd_queue */
+	struct list_head cmd_queue; /* pending struct gsa_mbox_cmd_ctx */
+	struct work_struct cmd_work; /* drains cmd_queue for async callers */
 	u32 exp_intmr0;
 	u32 wake_ref_cnt;
 	struct device *s2mpu;
@@ -203,6 +207,15 @@ static int gsa_link_s2mpu(struct device *dev, struct gsa_mbox *mb)
 }
 #endif /* CONFIG_GSA_PKVM */
 
+static void gsa_mbox_cmd_work(struct work_struct *work);
+
+static void gsa_mbox_cancel_work(void *ctx)
+{
+	struct gsa_mbox *mb = ctx;
+
+	cancel_work_sync(&mb->cmd_work);
+}
+
 struct gsa_mbox *gsa_mbox_init(struct platform_device *pdev)
 {
 	int err;
@@ -222,6 +235,9 @@ struct gsa_mbox *gsa_mbox_init(struct platform_device *pdev)
 	spin_lock_init(&mb->slock);
 	mutex_init(&mb->mbox_lock);
 	init_completion(&mb->mbox_cmd_completion);
+	spin_lock_init(&mb->queue_lock);
+	INIT_LIST_HEAD(&mb->cmd_queue);
+	INIT_WORK(&mb->cmd_work, gsa_mbox_cmd_work);
 
 	/* map mbox registers */
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
@@ -249,6 +265,11 @@ struct gsa_mbox *gsa_mbox_init(struct platform_device *pdev)
 		return ERR_PTR(err);
 	}
 
+	/* make sure queue is not drained after irq is gone */
+	err = devm_add_action_or_reset(dev, gsa_mbox_cancel_work, mb);
+	if (err)
+		return ERR_PTR(err);
+
 	return mb;
 }
 
@@ -569,31 +590,120 @@ static void gsa_data_xfer_finish_locked(struct gsa_mbox *mb) {}
 
 #endif /* CONFIG_GSA_PKVM */
 
-int gsa_send_mbox_cmd(struct gsa_mbox *mb, u32 cmd,
-		      u32 *req_args, u32 req_argc,
-		      u32 *rsp_args, u32 rsp_max_argc)
+/*
+ * The mailbox has a single set of shared registers, so commands are executed
+ * one at a time. Callers queue their commands and whoever holds mbox_lock
+ * executes a batch of them. Data transfer commands drained together share
+ * one data transfer prepare/finish (under PKVM a wakelock acquire/release
+ * round trip and an s2mpu resume/suspend).
+ *
+ * A batch is the commands queued up to and including @last, or everything
+ * queued so far if @last is NULL. Commands queued later are left for the
+ * next drainer, so a caller never ends up serving a continuous stream of
+ * other callers' commands.
+ */
+static void gsa_mbox_drain_locked(struct gsa_mbox *mb,
+				  struct gsa_mbox_cmd_ctx *last)
 {
-	int ret;
-	bool data_xfer = is_data_xfer(cmd);
+	struct gsa_mbox_cmd_ctx *ctx, *tmp;
+	bool data_xfer = false;
+	unsigned long flags;
+	LIST_HEAD(batch);
+
+	spin_lock_irqsave(&mb->queue_lock, flags);
+	if (last)
+		list_cut_position(&batch, &mb->cmd_queue, &last->node);
+	else
+		list_splice_init(&mb->cmd_queue, &batch);
+	spin_unlock_irqrestore(&mb->queue_lock, flags);
+
+	list_for_each_entry_safe(ctx, tmp, &batch, node) {
+		/* ctx may go away as soon as it is completed */
+		list_del(&ctx->node);
+
+		if (!data_xfer && is_data_xfer(ctx->cmd)) {
+			ctx->ret = gsa_data_xfer_prepare_locked(mb);
+			if (ctx->ret < 0) {
+				complete(&ctx->done);
+				continue;
+			}
+			data_xfer = true;
+		}
+
+		/* send command */
+		ctx->ret = gsa_send_mbox_cmd_locked(mb, ctx->cmd,
+						    ctx->req_args,
+						    ctx->req_argc,
+						    ctx->rsp_args,
+						    ctx->rsp_max_argc);
+		complete(&ctx->done);
+	}
+
+	if (data_xfer)
+		gsa_data_xfer_finish_locked(mb);
+}
+
+static void gsa_mbox_cmd_work(struct work_struct *work)
+{
+	struct gsa_mbox *mb = container_of(work, struct gsa_mbox, cmd_work);
 
 	mutex_lock(&mb->mbox_lock);
+	gsa_mbox_drain_locked(mb, NULL);
+	mutex_unlock(&mb->mbox_lock);
+}
 
-	if (data_xfer) {
-		ret = gsa_data_xfer_prepare_locked(mb);
-		if (ret < 0)
-			goto err_data_prepare;
-	}
+static void gsa_mbox_enqueue(struct gsa_mbox *mb, struct gsa_mbox_cmd_ctx *ctx)
+{
+	unsigned long flags;
 
-	/* send command */
-	ret = gsa_send_mbox_cmd_locked(mb, cmd, req_args, req_argc,
-				       rsp_args, rsp_max_argc);
+	init_completion(&ctx->done);
+	ctx->ret = 0;
 
-	if (data_xfer)
-		gsa_data_xfer_finish_locked(mb);
+	spin_lock_irqsave(&mb->queue_lock, flags);
+	list_add_tail(&ctx->node, &mb->cmd_queue);
+	spin_unlock_irqrestore(&mb->queue_lock, flags);
+}
+
+void gsa_send_mbox_cmd_async(struct gsa_mbox *mb, struct gsa_mbox_cmd_ctx *ctx)
+{
+	gsa_mbox_enqueue(mb, ctx);
+	queue_work(system_unbound_wq, &mb->cmd_work);
+}
+
+int gsa_wait_mbox_cmd(struct gsa_mbox_cmd_ctx *ctx)
+{
+	wait_for_completion(&ctx->done);
+	return ctx->ret;
+}
+
+int gsa_send_mbox_cmd(struct gsa_mbox *mb, u32 cmd,
+		      u32 *req_args, u32 req_argc,
+		      u32 *rsp_args, u32 rsp_max_argc)
+{
+	struct gsa_mbox_cmd_ctx ctx = {
+		.cmd = cmd,
+		.req_args = req_args,
+		.req_argc = req_argc,
+		.rsp_args = rsp_args,
+		.rsp_max_argc = rsp_max_argc,
+	};
+
+	if (!mb)
+		return -ENODEV;
 
-err_data_prepare:
+	gsa_mbox_enqueue(mb, &ctx);
+
+	/*
+	 * Drain the queue up to our command unless somebody already ran it.
+	 * Drainers hold mbox_lock, so a command not completed by now is still
+	 * queued.
+	 */
+	mutex_lock(&mb->mbox_lock);
+	if (!completion_done(&ctx.done))
+		gsa_mbox_drain_locked(mb, &ctx);
 	mutex_unlock(&mb->mbox_lock);
-	return ret;
+
+	return gsa_wait_mbox_cmd(&ctx);
 }
 
 MODULE_LICENSE("GPL v2");
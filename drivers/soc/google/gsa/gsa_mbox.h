@@ -5,7 +5,9 @@
 #ifndef __LINUX_GSA_MBOX_H
 #define __LINUX_GSA_MBOX_H
 
+#include <linux/completion.h>
 #include <linux/dma-mapping.h>
+#include <linux/list.h>
 #include <linux/platform_device.h>
 
 /**
@@ -203,10 +205,41 @@ enum app_pkg_load_req_args {
 
 struct gsa_mbox;
 
+/**
+ * struct gsa_mbox_cmd_ctx - queued mailbox command
+ * @node:         entry in mailbox command queue
+ * @cmd:          command to send
+ * @req_args:     request arguments
+ * @req_argc:     number of request arguments
+ * @rsp_args:     buffer for response arguments
+ * @rsp_max_argc: size of @rsp_args
+ * @ret:          number of response arguments or negative error, valid once
+ *                @done is completed
+ * @done:         completed when the response has been received
+ *
+ * Owned by the caller; @req_args and @rsp_args must stay valid until @done
+ * is completed.
+ */
+struct gsa_mbox_cmd_ctx {
+	struct list_head node;
+	u32 cmd;
+	u32 *req_args;
+	u32 req_argc;
+	u32 *rsp_args;
+	u32 rsp_max_argc;
+	int ret;
+	struct completion done;
+};
+
 struct gsa_mbox *gsa_mbox_init(struct platform_device *pdev);
 
 int gsa_send_mbox_cmd(struct gsa_mbox *mb, u32 cmd,
 		      u32 *req_args, u32 req_argc,
 		      u32 *rsp_args, u32 rsp_argc);
 
+void gsa_send_mbox_cmd_async(struct gsa_mbox *mb,
+			     struct gsa_mbox_cmd_ctx *ctx);
+
+int gsa_wait_mbox_cmd(struct gsa_mbox_cmd_ctx *ctx);
+
 #endif /* __LINUX_GSA_MBOX_H */
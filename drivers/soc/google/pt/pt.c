@@ -33,6 +33,11 @@ struct pt_pts {
 	u32 size; /* current size of the partition, 0 if disabled */
 	ptid_t ptid; /* partition index */
 	int property_index; /* index in the driver properties */
+	u32 size_min; /* smallest useful size, from pt_client_set_size_hint() */
+	u32 size_preferred; /* size the client would like */
+	u32 resize_cnt; /* number of non-zero sizes given by the driver */
+	u32 below_min_cnt; /* ... of which were below size_min */
+	u32 below_preferred_cnt; /* ... of which were below size_preferred */
 	struct pt_handle *handle;
 	struct pt_driver *driver; /* driver managing this partition */
 	struct list_head resize_list; /* resize_thread callback list */
@@ -267,6 +272,26 @@ static void pt_resize_internal_nop(void *data, size_t size)
 {
 }
 
+/*
+ * Count how often the driver gives a partition less than the client hinted
+ * with pt_client_set_size_hint(). A zero size is a disabled partition.
+ */
+static void pt_resize_account(struct pt_pts *pts, size_t size)
+{
+	unsigned long flags;
+
+	if (size == 0)
+		return;
+
+	spin_lock_irqsave(&pt_internal_data.sl, flags);
+	pts->resize_cnt++;
+	if (size < pts->size_min)
+		pts->below_min_cnt++;
+	else if (size < pts->size_preferred)
+		pts->below_preferred_cnt++;
+	spin_unlock_irqrestore(&pt_internal_data.sl, flags);
+}
+
 static void pt_resize_internal(void *data, size_t size)
 {
 	struct pt_pts *pts = (struct pt_pts *)data;
@@ -275,6 +300,7 @@ static void pt_resize_internal(void *data, size_t size)
 	trace_pt_resize_callback(pts->handle->node->name,
 		pts->driver->properties->nodes[pts->property_index]->name,
 		true, (int)size, pts->ptid);
+	pt_resize_account(pts, size);
 	if (handle->resize_callback) {
 		pt_resize_list_add(pts, size);
 	} else {
@@ -747,6 +773,21 @@ ptid_t pt_client_enable(struct pt_handle *handle, int id)
 	return pt_client_enable_size(handle, id, &size);
 }
 
+int pt_client_set_size_hint(struct pt_handle *handle, int id, size_t min_size,
+	size_t preferred_size)
+{
+	unsigned long flags;
+
+	pt_handle_check(handle, id);
+	if (min_size > preferred_size || preferred_size > U32_MAX)
+		return -EINVAL;
+	spin_lock_irqsave(&pt_internal_data.sl, flags);
+	handle->pts[id].size_min = min_size;
+	handle->pts[id].size_preferred = preferred_size;
+	spin_unlock_irqrestore(&pt_internal_data.sl, flags);
+	return 0;
+}
+
 
 void pt_client_unregister(struct pt_handle *handle)
 {
@@ -1287,6 +1328,7 @@ EXPORT_SYMBOL(pt_client_unregister);
 EXPORT_SYMBOL(pt_client_enable_size);
 EXPORT_SYMBOL(pt_client_disable_no_free);
 EXPORT_SYMBOL(pt_client_free);
+EXPORT_SYMBOL(pt_client_set_size_hint);
 
 EXPORT_SYMBOL(pt_driver_register);
 EXPORT_SYMBOL(pt_driver_unregister);
@@ -6,6 +6,7 @@
  */
 #include <linux/kernel.h>
 #include <linux/slab.h>
+#include <linux/string.h>
 #include <linux/io.h>
 #include <linux/dma-mapping.h>
 #include <linux/bits.h>
@@ -98,6 +99,15 @@ static struct smpt_region *alloc_smpt(struct s2mpu_info *info, size_t len)
 	if (WARN_ON(len != 128 && len != 4096 && len != (64 * 1024)))
 		return NULL;
 
+	/* only decompose() allocates, and it overwrites the whole table */
+	list_for_each_entry(r, &info->smpt_cache, list) {
+		if (r->len == len) {
+			info->smpt_cache_cnt--;
+			list_move(&r->list, &info->smpt_regions);
+			return r;
+		}
+	}
+
 	r = kmalloc(sizeof(*r), GFP_ATOMIC);
 	if (unlikely(!r))
 		return NULL;
@@ -120,7 +130,8 @@ out_free:
 	return r;
 }
 
-static void free_smpt(struct s2mpu_info *info, void *buf)
+/* move the region backing @buf to @freelist, see free_smpt_list() */
+static void unlink_smpt(struct s2mpu_info *info, void *buf, struct list_head *freelist)
 {
 	struct smpt_region *tmp, *r = NULL;
 
@@ -139,9 +150,37 @@ static void free_smpt(struct s2mpu_info *info, void *buf)
 		return;
 	}
 
-	list_del(&r->list);
-	dma_free_coherent(info->dev, r->len, r->va, r->pa);
-	kfree(r);
+	list_move(&r->list, freelist);
+}
+
+/* dma_free_coherent() must not be called with interrupts disabled, so SMPTs
+ * dropped under info->lock are freed here once it has been released. the
+ * MPTC no longer refers to them by then, so up to S2MPU_SMPT_CACHE_MAX of
+ * them are kept for reuse instead: a window that is repeatedly opened and
+ * closed would otherwise free and re-allocate a 64KB table each time, the
+ * allocation being GFP_ATOMIC under the lock.
+ */
+#define S2MPU_SMPT_CACHE_MAX 2
+
+static void free_smpt_list(struct s2mpu_info *info, struct list_head *freelist)
+{
+	struct smpt_region *curr, *next;
+	unsigned long flags;
+
+	spin_lock_irqsave(&info->lock, flags);
+	list_for_each_entry_safe(curr, next, freelist, list) {
+		if (info->smpt_cache_cnt >= S2MPU_SMPT_CACHE_MAX)
+			break;
+		list_move(&curr->list, &info->smpt_cache);
+		info->smpt_cache_cnt++;
+	}
+	spin_unlock_irqrestore(&info->lock, flags);
+
+	list_for_each_entry_safe(curr, next, freelist, list) {
+		list_del(&curr->list);
+		dma_free_coherent(info->dev, curr->len, curr->va, curr->pa);
+		kfree(curr);
+	}
 }
 
 void s2mpu_lib_deinit(struct s2mpu_info *info)
@@ -178,6 +217,8 @@ void s2mpu_lib_deinit(struct s2mpu_info *info)
 	__raw_writel(reg, S2MPU_ALL_INVALIDATION(base));
 
 	/* unmap SMPT and free up memory allocated in s2mpu_dev_init() */
+	list_splice_init(&info->smpt_cache, &info->smpt_regions);
+	info->smpt_cache_cnt = 0;
 	list_for_each_entry_safe(curr, next, &info->smpt_regions, list) {
 		list_del(&curr->list);
 
@@ -239,6 +280,9 @@ struct s2mpu_info *s2mpu_lib_init(struct device *dev, void __iomem *base,
 	info->sidcount = sidcount;
 	info->vid = vid;
 	INIT_LIST_HEAD(&info->smpt_regions);
+	INIT_LIST_HEAD(&info->smpt_cache);
+	info->smpt_cache_cnt = 0;
+	memset(info->closes_since_open, 0, sizeof(info->closes_since_open));
 
 	spin_lock_init(&info->lock);
 
@@ -387,47 +431,15 @@ static enum s2_gran l1_existing_granularity(u32 l1_entry)
 	return granule;
 }
 
-static size_t get_byte_offset(u64 addr, enum s2_gran g)
-{
-	size_t granularity_shift = gran_shift[g];
-
-	/* byte offset within 1gb */
-	addr &= 0x3fffffff;
-	/* get entry number */
-	addr >>= granularity_shift;
-	/* there are 4 of these per byte so divide by 4 to get the byte */
-	addr >>= 2;
-
-	return addr;
-}
-
-static size_t get_bit_offset(u64 addr, enum s2_gran g)
-{
-	size_t granularity_shift = gran_shift[g];
-
-	addr &= 0x3fffffff;
-	/* get page number */
-	addr >>= granularity_shift;
-	/* last two bits (i.e. modulo 4) should give us entry number within byte */
-	addr &= 3;
-	/* every entry is 2 bits long so multiply by 2 to get bit offset */
-	addr <<= 1;
-
-	return addr;
-}
-
+/* invalidate MPTC entries of @vmid for [start, end), both 4KB aligned */
 static void range_invalidate_mptc_vid_specific(void __iomem *base, u32 vmid,
-					       phys_addr_t start, enum s2_gran g)
+					       phys_addr_t start, phys_addr_t end)
 {
-	size_t shift = gran_shift[g];
-	u64 mask = (WHI_PHY_ADDR_MASK << shift) & WHI_PHY_ADDR_MASK;
 	u32 val;
 
-	start = start & mask;
-	val = start >> 12;
+	val = (start & WHI_PHY_ADDR_MASK) >> 12;
 	__raw_writel(val, S2MPU_RANGE_INVALIDATION_START_PPN(base));
-	start = start + (1 << shift);
-	val = start >> 12;
+	val = end >> 12;
 	__raw_writel(val, S2MPU_RANGE_INVALIDATION_END_PPN(base));
 
 	val = (vmid << S2MPU_RANGE_INVALIDATION_VID_SHIFT) |
@@ -497,8 +509,8 @@ static struct smpt_region *get_smpt_region(struct s2mpu_info *info, u32 gb_index
 	return r;
 }
 
-static void decompose(struct s2mpu_info *info, u32 gb_index, enum s2_gran curr_gran,
-		      enum s2_gran new_gran)
+static int decompose(struct s2mpu_info *info, u32 gb_index, enum s2_gran curr_gran,
+		     enum s2_gran new_gran, struct list_head *freelist)
 {
 	struct smpt_region *r = alloc_smpt(info, s2_table_size(gran_shift[new_gran]));
 	u8 *new_smpt, *curr_smpt;
@@ -506,7 +518,7 @@ static void decompose(struct s2mpu_info *info, u32 gb_index, enum s2_gran curr_g
 
 	if (!r) {
 		dev_err(info->dev, "failed to allocate smpt\n");
-		return;
+		return -ENOMEM;
 	}
 
 	new_smpt = r->va;
@@ -516,7 +528,7 @@ static void decompose(struct s2mpu_info *info, u32 gb_index, enum s2_gran curr_g
 
 		if (WARN_ON(!curr_r)) {
 			dev_err(info->dev, "failed to find smpt region\n");
-			return;
+			return -EINVAL;
 		}
 
 		curr_smpt = curr_r->va;
@@ -544,39 +556,151 @@ static void decompose(struct s2mpu_info *info, u32 gb_index, enum s2_gran curr_g
 	info->pt.l1entry_attrs[gb_index] = new_l1;
 
 	if (curr_gran != S2_GRAN_1GB)
-		free_smpt(info, curr_smpt);
+		unlink_smpt(info, curr_smpt, freelist);
+
+	return 0;
 }
 
-static void open_close_granules(struct s2mpu_info *info, u64 start,
-				enum s2_gran win_gran, size_t gcount,
-				bool open, enum dma_data_direction dir);
+static enum s2_gran get_gran(u64 num)
+{
+	/* could use arm's rbit + clz instructions to count the number of
+	 * trailing zeros but don't see justifiable benefit.
+	 */
+	if ((num & (0xffffffffffffffff << gran_shift[S2_GRAN_1GB])) == num)
+		return S2_GRAN_1GB;
+	if ((num & (0xffffffffffffffff << gran_shift[S2_GRAN_2MB])) == num)
+		return S2_GRAN_2MB;
+	if ((num & (0xffffffffffffffff << gran_shift[S2_GRAN_64KB])) == num)
+		return S2_GRAN_64KB;
+	if ((num & (0xffffffffffffffff << gran_shift[S2_GRAN_4KB])) == num)
+		return S2_GRAN_4KB;
+
+	/* we should not reach here. validation checks in s2_open and s2_close
+	 * should have ensured that we only proceed with correctly aligned
+	 * and sized windows.
+	 */
+	return S2_GRAN_INVALID;
+}
+
+/* a range update in progress: MPTC range to invalidate and SMPTs to free */
+struct s2_update {
+	phys_addr_t inv_start;
+	phys_addr_t inv_end;
+	struct list_head freelist;
+};
 
-static void open_close_granule(struct s2mpu_info *info, phys_addr_t start, enum s2_gran g,
-			       bool open, enum dma_data_direction dir)
+static void update_widen(struct s2_update *u, phys_addr_t start, phys_addr_t end)
 {
-	u32 gb_index = start >> gran_shift[S2_GRAN_1GB];
-	enum s2_gran eg;
-	u32 l1_entry;
-	unsigned long flags;
-	enum dir_mask dm;
+	u->inv_start = min(u->inv_start, start);
+	u->inv_end = max(u->inv_end, end);
+}
 
-	if (WARN_ON(dir == DMA_NONE))
-		return;
+/* apply open/close to 2-bit SMPT entries [first, first + count) */
+static void smpt_update_entries(u8 *smpt, size_t first, size_t count, bool open,
+				enum dir_mask dm)
+{
+	size_t end = first + count;
+	u8 fill = extend_to_byte(dm);
+	size_t sh;
+
+	/* leading entries sharing a byte with entries outside the range */
+	for (; first < end && (first & 3); first++) {
+		sh = (first & 3) << 1;
+		if (open)
+			smpt[first >> 2] |= dm << sh;
+		else
+			smpt[first >> 2] &= ~(3 << sh);
+	}
 
-	if (dir == DMA_BIDIRECTIONAL)
-		dm = DIR_BIDRECTIONAL;
-	else if (dir == DMA_TO_DEVICE)
-		dm = DIR_READ;
-	else if (dir == DMA_FROM_DEVICE)
-		dm = DIR_WRITE;
+	/* whole bytes */
+	if (!open && end - first >= 4) {
+		memset(smpt + (first >> 2), 0, (end - first) >> 2);
+		first += (end - first) & ~(size_t)3;
+	}
+	for (; first + 4 <= end; first += 4)
+		smpt[first >> 2] |= fill;
+
+	/* trailing entries */
+	for (; first < end; first++) {
+		sh = (first & 3) << 1;
+		if (open)
+			smpt[first >> 2] |= dm << sh;
+		else
+			smpt[first >> 2] &= ~(3 << sh);
+	}
+}
 
-	if (WARN_ON(gb_index >= 64))
-		return;
+/* point gb_index back at a plain L1 entry with @two_bits permissions */
+static void set_l1_gb(struct s2mpu_info *info, u32 gb_index, u8 two_bits)
+{
+	u32 new_l1 = (0 << S2MPU_L1ENTRY_ATTR_L2TABLE_EN_SHIFT) |
+			((two_bits & 1) << S2MPU_L1ENTRY_ATTR_RD_ACCESS_SHIFT) |
+			(((two_bits >> 1) & 1) << S2MPU_L1ENTRY_ATTR_WR_ACCESS_SHIFT) |
+			(0 << S2MPU_L1ENTRY_ATTR_L2TABLE_GRANULE_SHIFT);
+
+	__raw_writel(new_l1, S2MPU_L1ENTRY_ATTR(info->base, info->vid, gb_index));
+	info->pt.l1entry_attrs[gb_index] = new_l1;
+}
+
+/* number of closes without an open in between before a 1GB region is
+ * considered for coarsening. a window that keeps being opened and closed
+ * never gets there, so its SMPT is neither dropped and re-decomposed nor
+ * scanned under info->lock on every close.
+ */
+#define S2MPU_COARSEN_CLOSES 4
+
+/* if every entry of the SMPT of gb_index carries the same permissions,
+ * replace it with the equivalent 1GB L1 entry.
+ */
+static bool try_coarsen(struct s2mpu_info *info, u32 gb_index, enum s2_gran g,
+			bool open, struct s2_update *u)
+{
+	struct smpt_region *r;
+	size_t len = s2_table_size(gran_shift[g]);
+	u8 *smpt;
+	u8 b;
+
+	if (open) {
+		info->closes_since_open[gb_index] = 0;
+		return false;
+	}
+	if (info->closes_since_open[gb_index] < S2MPU_COARSEN_CLOSES)
+		info->closes_since_open[gb_index]++;
+	if (info->closes_since_open[gb_index] < S2MPU_COARSEN_CLOSES)
+		return false;
+
+	r = get_smpt_region(info, gb_index);
+	if (WARN_ON(!r))
+		return false;
+
+	smpt = r->va;
+	b = smpt[0];
+	if (b != extend_to_byte(b & 3) || smpt[len - 1] != b ||
+	    memchr_inv(smpt, b, len))
+		return false;
+
+	set_l1_gb(info, gb_index, b & 3);
+	unlink_smpt(info, smpt, &u->freelist);
+	info->closes_since_open[gb_index] = 0;
+	return true;
+}
+
+/* open or close [start, start + len) which lies within a single 1GB region */
+static int open_close_gb(struct s2mpu_info *info, phys_addr_t start, size_t len,
+			 bool open, enum dir_mask dm, struct s2_update *u)
+{
+	u32 gb_index = start >> gran_shift[S2_GRAN_1GB];
+	phys_addr_t gb_start = (phys_addr_t)gb_index << gran_shift[S2_GRAN_1GB];
+	phys_addr_t gb_end = gb_start + BIT_ULL(gran_shift[S2_GRAN_1GB]);
+	u32 l1_entry = info->pt.l1entry_attrs[gb_index];
+	enum s2_gran eg = l1_existing_granularity(l1_entry);
+	enum s2_gran g;
+	struct smpt_region *r;
+	size_t first;
+	int ret;
 
-	l1_entry = info->pt.l1entry_attrs[gb_index];
-	eg = l1_existing_granularity(l1_entry);
-	if (eg == g) {
-		if (eg == S2_GRAN_1GB) {
+	if (eg == S2_GRAN_1GB) {
+		if (len == BIT_ULL(gran_shift[S2_GRAN_1GB])) {
 			u32 one_gb_rw = dm << S2MPU_L1ENTRY_ATTR_RD_ACCESS_SHIFT;
 
 			if (open)
@@ -584,97 +708,51 @@ static void open_close_granule(struct s2mpu_info *info, phys_addr_t start, enum
 			else
 				l1_entry = l1_entry & ~(3U << S2MPU_L1ENTRY_ATTR_RD_ACCESS_SHIFT);
 			__raw_writel(l1_entry, S2MPU_L1ENTRY_ATTR(info->base, info->vid, gb_index));
-			/* invalidate S2MPU cache */
-			range_invalidate_mptc_vid_specific(info->base, info->vid, start, eg);
 
 			/* update page tables for resume from suspend case */
 			info->pt.l1entry_attrs[gb_index] = l1_entry;
-		} else {
-			/* we need to modify SMPT */
-			struct smpt_region *r = get_smpt_region(info, gb_index);
-			size_t byte_offset = get_byte_offset(start, eg);
-			size_t bit_offset;
-			u8 *smpt;
-			u8 b;
-
-			if (WARN_ON(!r))
-				return;
-
-			smpt = r->va;
-
-			bit_offset = get_bit_offset(start, eg);
-			if (WARN_ON(bit_offset >= BITS_PER_BYTE || (bit_offset & 1) != 0))
-				return;
-
-			spin_lock_irqsave(&info->lock, flags);
-			b = smpt[byte_offset];
-			if (open)
-				b = b | (dm << bit_offset);
-			else
-				b = b & ~(3 << bit_offset);
-			smpt[byte_offset] = b;
-
-			spin_unlock_irqrestore(&info->lock, flags);
-
-			/* invalidate MPTC */
-			range_invalidate_mptc_vid_specific(info->base, info->vid, start, eg);
+			return 0;
 		}
+
+		/* break the 1GB entry down to the window's granularity */
+		g = min(get_gran(start), get_gran(len));
+		ret = decompose(info, gb_index, eg, g, &u->freelist);
+		if (ret)
+			return ret;
+		update_widen(u, gb_start, gb_end);
+		eg = g;
+	} else if (!open && len == BIT_ULL(gran_shift[S2_GRAN_1GB])) {
+		/* closing all of it, no need to keep the SMPT around */
+		r = get_smpt_region(info, gb_index);
+		if (WARN_ON(!r))
+			return -EINVAL;
+		set_l1_gb(info, gb_index, 0);
+		unlink_smpt(info, r->va, &u->freelist);
+		info->closes_since_open[gb_index] = 0;
+		update_widen(u, gb_start, gb_end);
+		return 0;
 	} else {
-		/* This is the more complicated case where existing granularity
-		 * is different from requested granularity. There are two
-		 * possibilities here:
-		 * 1. existing_granularity < window_granularity
-		 * 2. existing_granularity > window_granularity
-		 *
-		 * For the first case, we will break window_granularity to be
-		 * same as existing_granularity. For the second case, we will have
-		 * to break existing granularity in SMPT to be the same as
-		 * window_granularity. The second case is more involved.
-		 */
-		if (eg < g) {
-			/* divide window_granularity by existing_granularity */
-			size_t gcount = 1 << (gran_shift[g] - gran_shift[eg]);
-
-			open_close_granules(info, start, eg, gcount, open, dir);
-		} else {
-			/* break existing granularity to match win gran */
-			decompose(info, gb_index, eg, g);
-			open_close_granule(info, start, g, open, dir);
+		g = min(get_gran(start), get_gran(len));
+		if (eg > g) {
+			ret = decompose(info, gb_index, eg, g, &u->freelist);
+			if (ret)
+				return ret;
+			update_widen(u, gb_start, gb_end);
+			eg = g;
 		}
 	}
-}
 
-static void open_close_granules(struct s2mpu_info *info, phys_addr_t start,
-				enum s2_gran win_gran, size_t gcount,
-				bool open, enum dma_data_direction dir)
-{
-	size_t i;
+	r = get_smpt_region(info, gb_index);
+	if (WARN_ON(!r))
+		return -EINVAL;
 
-	for (i = 0; i < gcount; i++) {
-		open_close_granule(info, start, win_gran, open, dir);
-		start += (1 << gran_shift[win_gran]);
-	}
-}
+	first = (start & (gb_end - gb_start - 1)) >> gran_shift[eg];
+	smpt_update_entries(r->va, first, len >> gran_shift[eg], open, dm);
 
-static enum s2_gran get_gran(u64 num)
-{
-	/* could use arm's rbit + clz instructions to count the number of
-	 * trailing zeros but don't see justifiable benefit.
-	 */
-	if ((num & (0xffffffffffffffff << gran_shift[S2_GRAN_1GB])) == num)
-		return S2_GRAN_1GB;
-	if ((num & (0xffffffffffffffff << gran_shift[S2_GRAN_2MB])) == num)
-		return S2_GRAN_2MB;
-	if ((num & (0xffffffffffffffff << gran_shift[S2_GRAN_64KB])) == num)
-		return S2_GRAN_64KB;
-	if ((num & (0xffffffffffffffff << gran_shift[S2_GRAN_4KB])) == num)
-		return S2_GRAN_4KB;
+	if (try_coarsen(info, gb_index, eg, open, u))
+		update_widen(u, gb_start, gb_end);
 
-	/* we should not reach here. validation checks in s2_open and s2_close
-	 * should have ensured that we only proceed with correctly aligned
-	 * and sized windows.
-	 */
-	return S2_GRAN_INVALID;
+	return 0;
 }
 
 static int validate(struct device *dev, phys_addr_t pa, size_t len)
@@ -713,8 +791,11 @@ int s2mpu_lib_open_close(struct s2mpu_info *info, phys_addr_t start, size_t len,
 			 bool open, enum dma_data_direction dir)
 {
 	/* ag = alignment granularity, lg = length granularity */
-	enum s2_gran ag, lg, winnerg;
-	size_t gcount;
+	enum s2_gran ag, lg;
+	struct s2_update u;
+	phys_addr_t addr, next, end = start + len;
+	unsigned long flags;
+	enum dir_mask dm;
 	int ret;
 
 	ret = validate(info->dev, start, len);
@@ -723,23 +804,46 @@ int s2mpu_lib_open_close(struct s2mpu_info *info, phys_addr_t start, size_t len,
 
 	ag = get_gran(start);
 	lg = get_gran(len);
-	if (WARN_ON(ag == S2_GRAN_INVALID || lg == S2_GRAN_INVALID)) {
+	if (WARN_ON(ag == S2_GRAN_INVALID || lg == S2_GRAN_INVALID) ||
+	    WARN_ON(dir == DMA_NONE)) {
 		ret = -EINVAL;
 		goto out;
 	}
-	/* three possibilities here:
-	 * 1. ag == lg:  gcount = window->size >> gran_shift[lg]
-	 * 2. ag < lg: gcount = window->size >> gran_shift[ag]
-	 * 3. ag > lg: gcount = window->size >> gran_shift[lg]
-	 *
-	 * TODO: there are potential optimisations here when larger
-	 * granularities are contained within smaller ag. let's consider them
-	 * later.
+
+	if (dir == DMA_BIDIRECTIONAL)
+		dm = DIR_BIDRECTIONAL;
+	else if (dir == DMA_TO_DEVICE)
+		dm = DIR_READ;
+	else
+		dm = DIR_WRITE;
+
+	u.inv_start = start;
+	u.inv_end = end;
+	INIT_LIST_HEAD(&u.freelist);
+
+	/* the window is handled one 1GB region at a time: whole regions only
+	 * touch their L1 entry, partial ones update their SMPT bytes in one
+	 * go. the MPTC is invalidated once for the whole window afterwards.
 	 */
-	winnerg = ag < lg ? ag : lg;
-	gcount = len >> gran_shift[winnerg];
+	spin_lock_irqsave(&info->lock, flags);
+	for (addr = start; addr < end; addr = next) {
+		next = min(end, round_down(addr, BIT_ULL(gran_shift[S2_GRAN_1GB])) +
+			   BIT_ULL(gran_shift[S2_GRAN_1GB]));
+		if (WARN_ON((addr >> gran_shift[S2_GRAN_1GB]) >= WHI_MAX_GB_GRANULES)) {
+			ret = -EINVAL;
+			break;
+		}
+		ret = open_close_gb(info, addr, next - addr, open, dm, &u);
+		if (ret)
+			break;
+	}
+
+	/* SMPT updates must be visible to the S2MPU before invalidating */
+	wmb();
+	range_invalidate_mptc_vid_specific(info->base, info->vid, u.inv_start, u.inv_end);
+	spin_unlock_irqrestore(&info->lock, flags);
 
-	open_close_granules(info, start, winnerg, gcount, open, dir);
+	free_smpt_list(info, &u.freelist);
 out:
 	return ret;
 }
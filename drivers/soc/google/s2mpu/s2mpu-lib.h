@@ -36,6 +36,11 @@ struct s2mpu_info {
 	struct s2pt pt;
 	/* this is list of s2mpu regions for this particular instance */
 	struct list_head smpt_regions;
+	/* SMPTs dropped by coarsening, kept for the next decompose */
+	struct list_head smpt_cache;
+	unsigned int smpt_cache_cnt;
+	/* closes of each 1GB region since it was last opened, see try_coarsen */
+	u8 closes_since_open[WHI_MAX_GB_GRANULES];
 	/* this is global list of s2mpu_info instances */
 	struct list_head list;
 	u32 *sids;
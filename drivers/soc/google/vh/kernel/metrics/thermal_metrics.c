@@ -12,7 +12,9 @@
 #include <linux/platform_device.h>
 #include <linux/threads.h>
 #include <linux/debugfs.h>
+#include <linux/seqlock.h>
 #include <linux/slab.h>
+#include <linux/workqueue.h>
 #include <soc/google/thermal_metrics.h>
 
 #define MAX_NUM_SUPPORTED_THERMAL_ZONES        36
@@ -45,8 +47,16 @@ struct thermal_group_entry {
 	struct temp_validity_config temp_validity_config;
 };
 
+/*
+ * temp_residency_stats_update() is the only writer of prev and of the bucket
+ * accumulation, serialized per instance by its thermal zone, and publishes
+ * them through seq. Threshold updates serialize on lock and publish through
+ * thr_seq, so the update path never blocks on either.
+ */
 struct temperature_residency_stats {
 	spinlock_t lock;
+	seqcount_spinlock_t thr_seq;
+	seqcount_t seq;
 	int threshold[MAX_SUPPORTED_THRESHOLDS];
 	atomic64_t time_in_state_ms[MAX_SUPPORTED_THRESHOLDS + 1];
 	struct tr_sample max_sample;
@@ -58,6 +68,10 @@ struct temperature_residency_stats {
 	struct thermal_group_entry *thermal_group;
 	bool use_callback;
 	struct temp_residency_stats_callbacks ops;
+	/* abnormalities detected on the update path, reported from abnormal_work */
+	unsigned long abnormal_pending;
+	int abnormal_temp[ABNORMALITY_TYPE_END];
+	struct work_struct abnormal_work;
 };
 
 static struct thermal_group_entry thermal_group_array[MAX_NUM_SUPPORTED_THERMAL_GROUPS];
@@ -106,33 +120,70 @@ static void set_residency_thresholds(tr_handle instance, const int *thresholds)
 	}
 
 	spin_lock(&stats->lock);
+	write_seqcount_begin(&stats->thr_seq);
 	for (index = 0; index < stats->num_thresholds; index++)
 		stats->threshold[index] = thresholds[index];
 	if (stats->started) {
 		reset_residency_stats(instance);
 		stats->started = false;
 	}
+	write_seqcount_end(&stats->thr_seq);
 	spin_unlock(&stats->lock);
 }
 
-static int get_curr_bucket(tr_handle instance, int temp)
+/*
+ * Copy a consistent threshold set into @threshold and binary search it for
+ * the bucket of @temp. Return the bucket, *num the number of thresholds.
+ */
+static int get_curr_bucket(tr_handle instance, int temp, int *threshold, int *num)
 {
-	int mid;
+	int mid, low, high;
+	unsigned int seq;
 	struct temperature_residency_stats *stats = &residency_stat_array[instance];
-	int low = 0, high = stats->num_thresholds;
 
-	spin_lock(&stats->lock);
+	do {
+		seq = read_seqcount_begin(&stats->thr_seq);
+		*num = stats->num_thresholds;
+		memcpy(threshold, stats->threshold, sizeof(stats->threshold));
+	} while (read_seqcount_retry(&stats->thr_seq, seq));
+
+	low = 0;
+	high = *num;
 	while (low != high) {
 		mid = (low + high) / 2;
-		if (stats->threshold[mid] < temp)
+		if (threshold[mid] < temp)
 			low = mid + 1;
 		else
 			high = mid;
 	}
-	spin_unlock(&stats->lock);
 	return low;
 }
 
+/*
+ * Snapshot the residency of @stats into @time_in_state_ms, crediting the time
+ * spent in the current bucket since the last update.
+ */
+static void get_residency_snapshot(struct temperature_residency_stats *stats,
+				   s64 *time_in_state_ms)
+{
+	unsigned int seq;
+	int index, bucket;
+	ktime_t update_time;
+	bool started;
+
+	do {
+		seq = read_seqcount_begin(&stats->seq);
+		for (index = 0; index < MAX_SUPPORTED_THRESHOLDS + 1; index++)
+			time_in_state_ms[index] = atomic64_read(&stats->time_in_state_ms[index]);
+		bucket = stats->prev.bucket;
+		update_time = stats->prev.update_time;
+		started = stats->started;
+	} while (read_seqcount_retry(&stats->seq, seq));
+
+	if (started && bucket >= 0 && bucket <= MAX_SUPPORTED_THRESHOLDS)
+		time_in_state_ms[bucket] += ktime_to_ms(ktime_sub(ktime_get(), update_time));
+}
+
 static int get_next_available_handle(void)
 {
 	int index;
@@ -275,6 +326,31 @@ int report_thermal_abnormal_uevent(tr_handle instance, enum abnormality_type typ
 	return 0;
 }
 
+static void thermal_abnormal_work(struct work_struct *work)
+{
+	struct temperature_residency_stats *stats =
+		container_of(work, struct temperature_residency_stats, abnormal_work);
+	tr_handle instance = stats - residency_stat_array;
+	int type;
+
+	for (type = 0; type < ABNORMALITY_TYPE_END; type++)
+		if (test_and_clear_bit(type, &stats->abnormal_pending))
+			report_thermal_abnormal_uevent(instance, type,
+						       READ_ONCE(stats->abnormal_temp[type]));
+}
+
+/*
+ * Building and sending the uevent allocates and may sleep, keep it off the
+ * temperature update path.
+ */
+static void queue_thermal_abnormal_uevent(struct temperature_residency_stats *stats,
+					  enum abnormality_type type, int temp)
+{
+	WRITE_ONCE(stats->abnormal_temp[type], temp);
+	if (!test_and_set_bit(type, &stats->abnormal_pending))
+		schedule_work(&stats->abnormal_work);
+}
+
 /**
  * verify_temp_range() - Verify if temp is within valid range.
  * @instance: tr_handle for the index of tz in residency_stat_array.
@@ -288,24 +364,18 @@ int report_thermal_abnormal_uevent(tr_handle instance, enum abnormality_type typ
 static int verify_temp_range(tr_handle instance, enum abnormality_type *abnormality_type)
 {
 	struct temperature_residency_stats *stats = &residency_stat_array[instance];
-	struct thermal_group_entry *thermal_group = stats->thermal_group;
+	struct temp_validity_config *config = &stats->thermal_group->temp_validity_config;
 	int temp = stats->prev.temp;
 
-	read_lock(&thermal_group->lock);
-	if (unlikely(thermal_group->temp_validity_config.min_temp > temp)) {
+	if (unlikely(READ_ONCE(config->min_temp) > temp))
 		*abnormality_type = EXTREME_LOW_TEMP;
-		goto err;
-	} else if (unlikely(thermal_group->temp_validity_config.max_temp < temp)) {
+	else if (unlikely(READ_ONCE(config->max_temp) < temp))
 		*abnormality_type = EXTREME_HIGH_TEMP;
-		goto err;
-	}
-	read_unlock(&thermal_group->lock);
-	return 0;
+	else
+		return 0;
 
-err:
-	read_unlock(&thermal_group->lock);
 	if (stats->prev.repeat_ct == 1)
-		report_thermal_abnormal_uevent(instance, *abnormality_type, temp);
+		queue_thermal_abnormal_uevent(stats, *abnormality_type, temp);
 	return 1;
 }
 
@@ -328,30 +398,24 @@ static int verify_temp_stuck(tr_handle instance, enum abnormality_type *abnormal
 {
 	struct temperature_residency_stats *stats = &residency_stat_array[instance];
 	struct temperature_bucket_sample *temp_sample = &stats->prev;
-	struct thermal_group_entry *thermal_group = stats->thermal_group;
+	struct temp_validity_config *config = &stats->thermal_group->temp_validity_config;
 	s64 repeat_msecs;
 
-	read_lock(&thermal_group->lock);
-	if (likely(temp_sample->repeat_ct < thermal_group->temp_validity_config.min_repeat_count))
-		goto ret;
+	if (likely(temp_sample->repeat_ct < READ_ONCE(config->min_repeat_count)))
+		return 0;
 	repeat_msecs = ktime_to_ms(ktime_sub(temp_sample->update_time,
 						temp_sample->start_time));
-	if (repeat_msecs < thermal_group->temp_validity_config.min_repeat_msecs)
-		goto ret;
-	read_unlock(&thermal_group->lock);
+	if (repeat_msecs < READ_ONCE(config->min_repeat_msecs))
+		return 0;
 
 	*abnormality_type = SENSOR_STUCK;
 	pr_debug("Thermal Abnormality Detected: sensor:%s temp:%d stuck %d cnt %lld ms",
 		stats->name, temp_sample->temp, temp_sample->repeat_ct, repeat_msecs);
-	report_thermal_abnormal_uevent(instance, *abnormality_type, temp_sample->temp);
+	queue_thermal_abnormal_uevent(stats, *abnormality_type, temp_sample->temp);
 
 	temp_sample->start_time = temp_sample->update_time;
 	temp_sample->repeat_ct = 1;
 	return 1;
-
-ret:
-	read_unlock(&thermal_group->lock);
-	return 0;
 }
 
 /*********************************************************************
@@ -373,6 +437,10 @@ tr_handle register_temp_residency_stats(const char *name, char *group_name)
 		return -EINVAL;
 	stats = &residency_stat_array[instance];
 	spin_lock_init(&stats->lock);
+	seqcount_spinlock_init(&stats->thr_seq, &stats->lock);
+	seqcount_init(&stats->seq);
+	stats->abnormal_pending = 0;
+	INIT_WORK(&stats->abnormal_work, thermal_abnormal_work);
 	strncpy(stats->name, name, THERMAL_NAME_LENGTH);
 	stats->num_thresholds = ARRAY_SIZE(default_thresholds);
 	set_residency_thresholds(instance, default_thresholds);
@@ -416,6 +484,7 @@ int unregister_temp_residency_stats(tr_handle instance)
 	if (instance < 0 || (instance >= MAX_NUM_SUPPORTED_THERMAL_ZONES))
 		return -EINVAL;
 	stats = &residency_stat_array[instance];
+	cancel_work_sync(&stats->abnormal_work);
 	strncpy(stats->name, "", THERMAL_NAME_LENGTH);
 	set_residency_thresholds(instance, default_thresholds);
 	stats->ops = (struct temp_residency_stats_callbacks){NULL, NULL, NULL, NULL};
@@ -467,15 +536,17 @@ EXPORT_SYMBOL_GPL(temp_residency_stats_set_thresholds);
  */
 int temp_residency_stats_update(tr_handle instance, int temp)
 {
-	int index, k, last_temp, curr_bucket, stride_len;
+	int index, k, last_temp, curr_bucket, stride_len, num_thresholds;
+	int threshold[MAX_SUPPORTED_THRESHOLDS];
 	int abnormality_detected = 0;
+	bool repeated = false;
 	ktime_t curr_time = ktime_get();
 	s64 latency_ms;
 	enum abnormality_type abnormality_type;
 	struct temperature_residency_stats *stats;
 	struct temperature_bucket_sample *prev_sample;
 
-	if (instance < 0 || instance > MAX_NUM_SUPPORTED_THERMAL_ZONES)
+	if (instance < 0 || instance >= MAX_NUM_SUPPORTED_THERMAL_ZONES)
 		return -EINVAL;
 	stats = &residency_stat_array[instance];
 
@@ -484,7 +555,10 @@ int temp_residency_stats_update(tr_handle instance, int temp)
 		return -EINVAL;
 
 	prev_sample = &stats->prev;
-	curr_bucket = get_curr_bucket(instance, temp);
+	curr_bucket = get_curr_bucket(instance, temp, threshold, &num_thresholds);
+
+	preempt_disable();
+	write_seqcount_begin(&stats->seq);
 	if (!stats->started) {
 		stats->started = true;
 		set_temperature_sample(&stats->max_sample, temp);
@@ -497,10 +571,8 @@ int temp_residency_stats_update(tr_handle instance, int temp)
 		if (temp == prev_sample->temp) {
 			prev_sample->update_time = curr_time;
 			prev_sample->repeat_ct++;
-			abnormality_detected = verify_temp_stuck(instance, &abnormality_type);
-			if (abnormality_detected)
-				return abnormality_type;
-			goto outlier_check;
+			repeated = true;
+			goto unlock;
 		}
 		goto end;
 	}
@@ -516,15 +588,15 @@ int temp_residency_stats_update(tr_handle instance, int temp)
 		if (stride_len == 1) {
 			atomic64_add(
 				mult_frac(k,
-				stats->threshold[index] - last_temp, 1000),
+				threshold[index] - last_temp, 1000),
 				&(stats->time_in_state_ms[index]));
-			last_temp = stats->threshold[index];
+			last_temp = threshold[index];
 		} else {
 			atomic64_add(
 				mult_frac(k,
-				stats->threshold[index - 1] - last_temp, 1000),
+				threshold[index - 1] - last_temp, 1000),
 				&(stats->time_in_state_ms[index]));
-			last_temp = stats->threshold[index - 1];
+			last_temp = threshold[index - 1];
 		}
 		index = index + stride_len;
 	}
@@ -541,7 +613,15 @@ end:
 		set_temperature_sample(&stats->max_sample, temp);
 	if (temp < stats->min_sample.temp)
 		set_temperature_sample(&stats->min_sample, temp);
-outlier_check:
+unlock:
+	write_seqcount_end(&stats->seq);
+	preempt_enable();
+
+	if (repeated) {
+		abnormality_detected = verify_temp_stuck(instance, &abnormality_type);
+		if (abnormality_detected)
+			return abnormality_type;
+	}
 	abnormality_detected = verify_temp_range(instance, &abnormality_type);
 	if (abnormality_detected)
 		return abnormality_type;
@@ -558,6 +638,7 @@ static ssize_t temp_residency_all_stats_show(struct kobject *kobj,
 					 char *buf)
 {
 	struct temperature_residency_stats *stats;
+	s64 time_in_state_ms[MAX_SUPPORTED_THRESHOLDS + 1];
 	int instance;
 	int index, ret;
 	int len = 0;
@@ -578,8 +659,11 @@ static ssize_t temp_residency_all_stats_show(struct kobject *kobj,
 				pr_err("stats read failed: %s\n", stats->name);
 				goto end_err;
 			}
+			for (index = 0; index < stats->num_thresholds + 1; index++)
+				time_in_state_ms[index] =
+					atomic64_read(&stats->time_in_state_ms[index]);
 		} else {
-			temp_residency_stats_update(instance, stats->prev.temp);
+			get_residency_snapshot(stats, time_in_state_ms);
 		}
 
 		len += sysfs_emit_at(buf, len, "THERMAL ZONE: %s\n", stats->name);
@@ -592,16 +676,16 @@ static ssize_t temp_residency_all_stats_show(struct kobject *kobj,
 		len += sysfs_emit_at(buf, len,
 			"NUM_TEMP_RESIDENCY_BUCKETS: %d\n", stats->num_thresholds + 1);
 		len += sysfs_emit_at(buf, len, "-inf - %d ====> %lldms\n",
-			stats->threshold[0], atomic64_read(&(stats->time_in_state_ms[0])));
+			stats->threshold[0], time_in_state_ms[0]);
 
 		for (index = 0; index < stats->num_thresholds - 1; index++)
 			len += sysfs_emit_at(buf, len, "%d - %d ====> %lldms\n",
 				stats->threshold[index], stats->threshold[index + 1],
-				atomic64_read(&(stats->time_in_state_ms[index + 1])));
+				time_in_state_ms[index + 1]);
 
 		len += sysfs_emit_at(buf, len, "%d - inf ====> %lldms\n\n",
 			stats->threshold[index],
-			atomic64_read(&(stats->time_in_state_ms[stats->num_thresholds])));
+			time_in_state_ms[stats->num_thresholds]);
 	}
 	return len;
 end_err:
@@ -628,6 +712,7 @@ static ssize_t temp_residency_name_stats_show(struct kobject *kobj,
 					 char *buf)
 {
 	struct temperature_residency_stats *designated_stats;
+	s64 time_in_state_ms[MAX_SUPPORTED_THRESHOLDS + 1];
 	int index, ret;
 	int len = 0;
 
@@ -647,8 +732,11 @@ static ssize_t temp_residency_name_stats_show(struct kobject *kobj,
 			pr_err("stats read failed: %s\n", designated_stats->name);
 			goto end_err;
 		}
+		for (index = 0; index < designated_stats->num_thresholds + 1; index++)
+			time_in_state_ms[index] =
+				atomic64_read(&designated_stats->time_in_state_ms[index]);
 	} else {
-		temp_residency_stats_update(designated_handle, designated_stats->prev.temp);
+		get_residency_snapshot(designated_stats, time_in_state_ms);
 	}
 	len += sysfs_emit_at(buf, len, "THERMAL ZONE: %s\n", designated_stats->name);
 	len += sysfs_emit_at(buf, len, "MAX_TEMP: %d\n", designated_stats->max_sample.temp);
@@ -658,17 +746,16 @@ static ssize_t temp_residency_name_stats_show(struct kobject *kobj,
 	len += sysfs_emit_at(buf, len, "MIN_TEMP_TIMESTAMP: %llds\n",
 			designated_stats->min_sample.timestamp);
 	len += sysfs_emit_at(buf, len, "-inf - %d ====> %lldms\n",
-			designated_stats->threshold[0],
-			atomic64_read(&(designated_stats->time_in_state_ms[0])));
+			designated_stats->threshold[0], time_in_state_ms[0]);
 
 	for (index = 0; index < designated_stats->num_thresholds - 1; index++)
 		len += sysfs_emit_at(buf, len, "%d - %d ====> %lldms\n",
 			designated_stats->threshold[index], designated_stats->threshold[index + 1],
-			 atomic64_read(&(designated_stats->time_in_state_ms[index + 1])));
+			time_in_state_ms[index + 1]);
 
 	len += sysfs_emit_at(buf, len, "%d - inf ====> %lldms\n\n",
 		designated_stats->threshold[index],
-	atomic64_read(&(designated_stats->time_in_state_ms[designated_stats->num_thresholds])));
+		time_in_state_ms[designated_stats->num_thresholds]);
 
 	return len;
 end_err:
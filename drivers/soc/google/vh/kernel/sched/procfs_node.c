@@ -61,6 +61,17 @@ extern void update_adpf_prio(struct task_struct *p, struct vendor_task_struct *v
 
 static void apply_uclamp_change(enum vendor_group group, enum uclamp_id clamp_id);
 
+/* Max vendor group list entries looked at per list lock hold */
+#define VG_SCAN_BATCH		64
+/* Runnable tasks updated between reschedule points */
+#define VG_UCLAMP_BATCH		16
+
+/* Moved tasks collected per write before their clamps are refreshed */
+#define VG_MOVE_BATCH		32
+
+/* Bumped on every group uclamp change, a stale walk stops early */
+static atomic_t vg_uclamp_gen[VG_MAX][UCLAMP_CNT];
+
 struct uclamp_se uclamp_default[UCLAMP_CNT];
 unsigned int pmu_poll_time_ms = 10;
 bool pmu_poll_enabled;
@@ -174,14 +185,15 @@ enum vendor_procfs_type {
 			const char __user *ubuf, \
 			size_t count, loff_t *pos) \
 		{									      \
-			char buf[MAX_PROC_SIZE];	\
+			char *buf;	\
 			int ret;   \
-			if (count >= sizeof(buf))	\
+			if (count >= PAGE_SIZE)	\
 				return -EINVAL;	\
-			if (copy_from_user(buf, ubuf, count))	\
-				return -EFAULT;	\
-			buf[count] = '\0';	\
+			buf = memdup_user_nul(ubuf, count);	\
+			if (IS_ERR(buf))	\
+				return PTR_ERR(buf);	\
 			ret = update_vendor_group_attribute(buf, VTA_TASK_GROUP, __vg);   \
+			kfree(buf);	\
 			return ret ?: count;						      \
 		}									      \
 		PROC_OPS_WO(set_task_group_##__grp);		\
@@ -189,14 +201,15 @@ enum vendor_procfs_type {
 			const char __user *ubuf, \
 			size_t count, loff_t *pos)		\
 		{									      \
-			char buf[MAX_PROC_SIZE];	\
+			char *buf;	\
 			int ret;   \
-			if (count >= sizeof(buf))	\
+			if (count >= PAGE_SIZE)	\
 				return -EINVAL;	\
-			if (copy_from_user(buf, ubuf, count))	\
-				return -EFAULT;	\
-			buf[count] = '\0';	\
+			buf = memdup_user_nul(ubuf, count);	\
+			if (IS_ERR(buf))	\
+				return PTR_ERR(buf);	\
 			ret = update_vendor_group_attribute(buf, VTA_PROC_GROUP, __vg);   \
+			kfree(buf);	\
 			return ret ?: count;						      \
 		}									      \
 		PROC_OPS_WO(set_proc_group_##__grp);
@@ -966,6 +979,32 @@ uclamp_update_active(struct task_struct *p, enum uclamp_id clamp_id)
 	task_rq_unlock(rq, p, &rf);
 }
 
+/* Same as uclamp_update_active() for every clamp_id, under one rq lock */
+static inline void uclamp_update_active_all(struct task_struct *p)
+{
+	enum uclamp_id clamp_id;
+	struct rq_flags rf;
+	struct rq *rq;
+
+	if (!uclamp_is_used())
+		return;
+
+	rq = task_rq_lock(p, &rf);
+
+	for (clamp_id = 0; clamp_id < UCLAMP_CNT; clamp_id++) {
+		if (!p->uclamp[clamp_id].active)
+			continue;
+
+		uclamp_rq_dec_id(rq, p, clamp_id);
+		uclamp_rq_inc_id(rq, p, clamp_id);
+
+		if (clamp_id == UCLAMP_MAX && rq->uclamp_flags & UCLAMP_FLAG_IDLE)
+			rq->uclamp_flags &= ~UCLAMP_FLAG_IDLE;
+	}
+
+	task_rq_unlock(rq, p, &rf);
+}
+
 /// ******************************************************************************** ///
 /// ********************* New code section ***************************************** ///
 /// ******************************************************************************** ///
@@ -1275,13 +1314,21 @@ fail:
 	return -EINVAL;
 }
 
+/*
+ * Return the next queued task of group, or NULL at the end of the list.
+ * Sleeping tasks are skipped VG_SCAN_BATCH entries at a time so that the
+ * list lock is not held with irqs off across the whole group.
+ */
 static inline struct task_struct *get_next_task(int group, struct list_head *head)
 {
 	unsigned long flags;
 	struct task_struct *p;
 	struct vendor_task_struct *vp;
 	struct list_head *cur;
+	int scanned;
 
+again:
+	scanned = 0;
 	raw_spin_lock_irqsave(&vendor_group_list[group].lock, flags);
 
 	if (list_empty(head)) {
@@ -1302,6 +1349,14 @@ static inline struct task_struct *get_next_task(int group, struct list_head *hea
 			return NULL;
 		}
 
+		if (++scanned > VG_SCAN_BATCH) {
+			/* removal of cur moves cur_iterator back, so resuming is safe */
+			vendor_group_list[group].cur_iterator = cur;
+			raw_spin_unlock_irqrestore(&vendor_group_list[group].lock, flags);
+			cond_resched();
+			goto again;
+		}
+
 		cur = cur->next;
 		vp = list_entry(cur, struct vendor_task_struct, node);
 		p = __container_of(vp, struct task_struct, android_vendor_data1);
@@ -1315,11 +1370,19 @@ static inline struct task_struct *get_next_task(int group, struct list_head *hea
 	return p;
 }
 
+/*
+ * Sleeping tasks pick up the new group clamp from rvh_uclamp_eff_get_pixel_mod()
+ * when they are next enqueued, so only queued tasks have their rq buckets
+ * refreshed here, VG_UCLAMP_BATCH at a time. A newer change to the same knob
+ * restarts the walk, so an older walk still in progress just stops.
+ */
 static void apply_uclamp_change(enum vendor_group group, enum uclamp_id clamp_id)
 {
 	struct task_struct *p;
 	unsigned long flags;
 	struct list_head *head = &vendor_group_list[group].list;
+	int gen = atomic_inc_return(&vg_uclamp_gen[group][clamp_id]);
+	int batch = 0;
 
 	if (trace_clock_set_rate_enabled()) {
 		char trace_name[32] = {0};
@@ -1337,6 +1400,13 @@ static void apply_uclamp_change(enum vendor_group group, enum uclamp_id clamp_id
 	while ((p = get_next_task(group, head))) {
 		uclamp_update_active(p, clamp_id);
 		put_task_struct(p);
+
+		if (++batch < VG_UCLAMP_BATCH)
+			continue;
+		batch = 0;
+		if (atomic_read(&vg_uclamp_gen[group][clamp_id]) != gen)
+			break;
+		cond_resched();
 	}
 }
 
@@ -1428,18 +1498,62 @@ static int update_uclamp_fork_reset(const char *buf, bool val)
 	return 0;
 }
 
-static int update_vendor_group_attribute(const char *buf, enum vendor_group_attribute vta,
-					 unsigned int new)
+/* Moved tasks whose rq clamp buckets still need a refresh */
+struct vg_move_batch {
+	struct task_struct *tasks[VG_MOVE_BATCH];
+	int nr;
+};
+
+static void vg_move_batch_flush(struct vg_move_batch *batch)
 {
-	struct vendor_task_struct *vp;
-	struct task_struct *p, *t;
-	enum uclamp_id clamp_id;
-	pid_t pid;
+	int i;
+
+	for (i = 0; i < batch->nr; i++) {
+		uclamp_update_active_all(batch->tasks[i]);
+		put_task_struct(batch->tasks[i]);
+	}
+	batch->nr = 0;
+}
+
+/*
+ * Move t to group new. Group util is migrated if p (the task itself or its
+ * thread group leader) is not RT. The clamp refresh is deferred to batch.
+ */
+static void vg_move_task(struct vg_move_batch *batch, struct task_struct *t,
+			 struct task_struct *p, unsigned int new)
+{
+	struct vendor_task_struct *vp = get_vendor_task_struct(t);
 	unsigned long flags;
 	int old;
 
-	if (kstrtoint(buf, 0, &pid) || pid <= 0)
-		return -EINVAL;
+	raw_spin_lock_irqsave(&vp->lock, flags);
+	old = vp->group;
+	if (old == new || t->flags & PF_EXITING) {
+		raw_spin_unlock_irqrestore(&vp->lock, flags);
+		return;
+	}
+
+#if IS_ENABLED(CONFIG_USE_VENDOR_GROUP_UTIL)
+	if (p->prio >= MAX_RT_PRIO)
+		migrate_vendor_group_util(t, old, new);
+#endif
+	if (vp->queued_to_list == LIST_QUEUED) {
+		remove_from_vendor_group_list(&vp->node, old);
+		add_to_vendor_group_list(&vp->node, new);
+	}
+	vp->group = new;
+	raw_spin_unlock_irqrestore(&vp->lock, flags);
+
+	get_task_struct(t);
+	batch->tasks[batch->nr++] = t;
+	if (batch->nr == VG_MOVE_BATCH)
+		vg_move_batch_flush(batch);
+}
+
+static int update_vendor_group_pid(struct vg_move_batch *batch, pid_t pid,
+				   enum vendor_group_attribute vta, unsigned int new)
+{
+	struct task_struct *p, *t;
 
 	rcu_read_lock();
 	p = find_task_by_vpid(pid);
@@ -1459,53 +1573,12 @@ static int update_vendor_group_attribute(const char *buf, enum vendor_group_attr
 
 	switch (vta) {
 	case VTA_TASK_GROUP:
-		vp = get_vendor_task_struct(p);
-		raw_spin_lock_irqsave(&vp->lock, flags);
-		old = vp->group;
-		if (old == new || p->flags & PF_EXITING) {
-			raw_spin_unlock_irqrestore(&vp->lock, flags);
-			break;
-		}
-
-#if IS_ENABLED(CONFIG_USE_VENDOR_GROUP_UTIL)
-		if (p->prio >= MAX_RT_PRIO)
-			migrate_vendor_group_util(p, old, new);
-#endif
-		if (vp->queued_to_list == LIST_QUEUED) {
-			remove_from_vendor_group_list(&vp->node, old);
-			add_to_vendor_group_list(&vp->node, new);
-		}
-		vp->group = new;
-		raw_spin_unlock_irqrestore(&vp->lock, flags);
-		for (clamp_id = 0; clamp_id < UCLAMP_CNT; clamp_id++)
-			uclamp_update_active(p, clamp_id);
+		vg_move_task(batch, p, p, new);
 		break;
 	case VTA_PROC_GROUP:
 		rcu_read_lock();
-		for_each_thread(p, t) {
-			get_task_struct(t);
-			vp = get_vendor_task_struct(t);
-			raw_spin_lock_irqsave(&vp->lock, flags);
-			old = vp->group;
-			if (old == new || t->flags & PF_EXITING) {
-				raw_spin_unlock_irqrestore(&vp->lock, flags);
-				put_task_struct(t);
-				continue;
-			}
-			if (vp->queued_to_list == LIST_QUEUED) {
-				remove_from_vendor_group_list(&vp->node, old);
-				add_to_vendor_group_list(&vp->node, new);
-			}
-			vp->group = new;
-			raw_spin_unlock_irqrestore(&vp->lock, flags);
-#if IS_ENABLED(CONFIG_USE_VENDOR_GROUP_UTIL)
-			if (p->prio >= MAX_RT_PRIO)
-				migrate_vendor_group_util(t, old, new);
-#endif
-			for (clamp_id = 0; clamp_id < UCLAMP_CNT; clamp_id++)
-				uclamp_update_active(t, clamp_id);
-			put_task_struct(t);
-		}
+		for_each_thread(p, t)
+			vg_move_task(batch, t, p, new);
 		rcu_read_unlock();
 		break;
 	default:
@@ -1517,6 +1590,45 @@ static int update_vendor_group_attribute(const char *buf, enum vendor_group_attr
 	return 0;
 }
 
+/*
+ * buf holds one or more PIDs separated by spaces, commas or newlines. All of
+ * them are moved before the clamps of the moved tasks are refreshed, at most
+ * VG_MOVE_BATCH tasks at a time. A PID that cannot be moved does not stop
+ * the others; the first such error is returned.
+ */
+static int update_vendor_group_attribute(char *buf, enum vendor_group_attribute vta,
+					 unsigned int new)
+{
+	struct vg_move_batch batch;
+	char *tok;
+	pid_t pid;
+	int ret = 0;
+	int err;
+	int cnt = 0;
+
+	batch.nr = 0;
+	while ((tok = strsep(&buf, " ,\n"))) {
+		if (!*tok)
+			continue;
+
+		if (kstrtoint(tok, 0, &pid) || pid <= 0) {
+			ret = -EINVAL;
+			break;
+		}
+
+		err = update_vendor_group_pid(&batch, pid, vta, new);
+		if (err && !ret)
+			ret = err;
+		cnt++;
+	}
+	vg_move_batch_flush(&batch);
+
+	if (!cnt && !ret)
+		return -EINVAL;
+
+	return ret;
+}
+
 SET_VENDOR_GROUP_STORE(ta, VG_TOPAPP);
 SET_VENDOR_GROUP_STORE(fg, VG_FOREGROUND);
 // VG_SYSTEM is default setting so set to VG_SYSTEM is essentially clear vendor group
@@ -71,6 +71,8 @@ static LIST_HEAD(drvdata_list);
 #define S3C64XX_SPI_MODE_BUS_TSZ_HALFWORD	BIT(17)
 #define S3C64XX_SPI_MODE_BUS_TSZ_WORD		(2 << 17)
 #define S3C64XX_SPI_MODE_BUS_TSZ_MASK		(3 << 17)
+#define S3C64XX_SPI_MODE_RX_RDY_LVL		GENMASK(16, 11)
+#define S3C64XX_SPI_MODE_RX_RDY_LVL_SHIFT	11
 #define S3C64XX_SPI_MODE_SELF_LOOPBACK		BIT(3)
 #define S3C64XX_SPI_MODE_RXDMA_ON		BIT(2)
 #define S3C64XX_SPI_MODE_TXDMA_ON		BIT(1)
@@ -155,6 +157,11 @@ static LIST_HEAD(drvdata_list);
 /* Make sure the busy wait won't take too long time. */
 #define MAX_CS_CLOCK_DELAY_US 20
 
+/* PIO chunks larger than this wait for the RX FIFO ready IRQ, not a spin */
+#define S3C64XX_SPI_POLLING_SIZE	32
+#define S3C64XX_SPI_RX_RDY_LVL_MAX	\
+	(S3C64XX_SPI_MODE_RX_RDY_LVL >> S3C64XX_SPI_MODE_RX_RDY_LVL_SHIFT)
+
 /**
  * struct s3c64xx_spi_port_config - SPI Controller hardware info
  * @fifo_lvl_mask: Bit-mask for {TX|RX}_FIFO_LVL bits in SPI_STATUS register.
@@ -540,6 +547,68 @@ static inline void writesw_32(void __iomem *addr, const void *buffer,
 	}
 }
 
+/*
+ * RX_RDY_LVL counts bytes for FIFOs up to 64 bytes, and 2 or 4 byte units
+ * for 128 and 256 byte FIFOs.
+ */
+static unsigned int s3c64xx_spi_rdy_lvl_unit(struct s3c64xx_spi_driver_data *sdd)
+{
+	unsigned int fifo_lvl = (FIFO_LVL_MASK(sdd) >> 1) + 1;
+
+	return DIV_ROUND_UP(fifo_lvl, 64);
+}
+
+/* Largest PIO chunk whose completion can be signalled by RX_RDY_LVL */
+static unsigned int s3c64xx_spi_irq_chunk_len(struct s3c64xx_spi_driver_data *sdd)
+{
+	unsigned int unit = s3c64xx_spi_rdy_lvl_unit(sdd);
+	unsigned int align = max(unit, sdd->cur_bpw / 8);
+
+	return rounddown(S3C64XX_SPI_RX_RDY_LVL_MAX * unit, align);
+}
+
+static bool s3c64xx_spi_use_irq(struct s3c64xx_spi_driver_data *sdd,
+				unsigned int len)
+{
+	unsigned int unit = s3c64xx_spi_rdy_lvl_unit(sdd);
+
+	if (sdd->cntrlr_info->secure_mode == SECURE_MODE)
+		return false;
+
+	return len > S3C64XX_SPI_POLLING_SIZE && !(len % unit) &&
+		len / unit <= S3C64XX_SPI_RX_RDY_LVL_MAX;
+}
+
+static void s3c64xx_spi_set_rx_rdy_lvl(struct s3c64xx_spi_driver_data *sdd,
+				       unsigned int len)
+{
+	void __iomem *regs = sdd->regs;
+	u32 val;
+
+	val = readl(regs + S3C64XX_SPI_MODE_CFG);
+	val &= ~S3C64XX_SPI_MODE_RX_RDY_LVL;
+	val |= (len / s3c64xx_spi_rdy_lvl_unit(sdd)) <<
+		S3C64XX_SPI_MODE_RX_RDY_LVL_SHIFT;
+	writel(val, regs + S3C64XX_SPI_MODE_CFG);
+}
+
+static void s3c64xx_spi_enable_rx_irq(struct s3c64xx_spi_driver_data *sdd)
+{
+	void __iomem *regs = sdd->regs;
+
+	writel(readl(regs + S3C64XX_SPI_INT_EN) |
+	       S3C64XX_SPI_INT_RX_FIFORDY_EN, regs + S3C64XX_SPI_INT_EN);
+}
+
+static void s3c64xx_spi_disable_rx_irq(struct s3c64xx_spi_driver_data *sdd)
+{
+	void __iomem *regs = sdd->regs;
+
+	writel(readl(regs + S3C64XX_SPI_INT_EN) &
+	       ~S3C64XX_SPI_INT_RX_FIFORDY_EN, regs + S3C64XX_SPI_INT_EN);
+	s3c64xx_spi_set_rx_rdy_lvl(sdd, 0);
+}
+
 static void enable_datapath(struct s3c64xx_spi_driver_data *sdd,
 			    struct spi_device *spi,
 			    struct spi_transfer *xfer, int dma_mode)
@@ -677,7 +746,7 @@ static inline void enable_cs(struct s3c64xx_spi_driver_data *sdd,
 }
 
 static int wait_for_xfer(struct s3c64xx_spi_driver_data *sdd,
-			 struct spi_transfer *xfer, int dma_mode)
+			 struct spi_transfer *xfer, int dma_mode, bool irq_mode)
 {
 	void __iomem *regs = sdd->regs;
 	unsigned long val;
@@ -691,6 +760,11 @@ static int wait_for_xfer(struct s3c64xx_spi_driver_data *sdd,
 	if (dma_mode) {
 		val = msecs_to_jiffies(ms) + 10;
 		val = wait_for_completion_timeout(&sdd->xfer_completion, val);
+	} else if (irq_mode) {
+		/* RX FIFO ready fires once the whole chunk has been shifted */
+		val = msecs_to_jiffies(ms) + 10;
+		val = wait_for_completion_timeout(&sdd->xfer_completion, val);
+		s3c64xx_spi_disable_rx_irq(sdd);
 	} else {
 		u32 status;
 
@@ -899,12 +973,8 @@ static int s3c64xx_spi_map_one_msg(struct s3c64xx_spi_driver_data *sdd,
 				   struct spi_message *msg,
 				   struct spi_transfer *xfer)
 {
-	struct s3c64xx_spi_info *sci = sdd->cntrlr_info;
 	struct device *dev = &sdd->pdev->dev;
 
-	if (msg->is_dma_mapped || sci->dma_mode != DMA_MODE)
-		return 0;
-
 	if (xfer->len <= ((FIFO_LVL_MASK(sdd) >> 1) + 1))
 		return 0;
 
@@ -939,20 +1009,53 @@ static void s3c64xx_spi_unmap_one_msg(struct s3c64xx_spi_driver_data *sdd,
 				      struct spi_message *msg,
 				      struct spi_transfer *xfer)
 {
-	struct s3c64xx_spi_info *sci = sdd->cntrlr_info;
 	struct device *dev = &sdd->pdev->dev;
 
-	if (msg->is_dma_mapped || sci->dma_mode != DMA_MODE)
-		return;
-
-	if (xfer->len <= ((FIFO_LVL_MASK(sdd) >> 1) + 1))
-		return;
-
 	if (xfer->rx_buf && xfer->rx_dma != DMA_MAPPING_ERROR)
 		dma_unmap_single(dev, xfer->rx_dma, xfer->len, DMA_FROM_DEVICE);
 
 	if (xfer->tx_buf && xfer->tx_dma != DMA_MAPPING_ERROR)
 		dma_unmap_single(dev, xfer->tx_dma, xfer->len, DMA_TO_DEVICE);
+
+	xfer->rx_dma = DMA_MAPPING_ERROR;
+	xfer->tx_dma = DMA_MAPPING_ERROR;
+}
+
+/*
+ * Map every DMA-sized transfer of the message in one pass before the first
+ * transfer starts, so that the transfer loop only has to program the DMA
+ * channels and split transfers along PACKET_CNT limits.
+ */
+static int s3c64xx_spi_map_msg(struct s3c64xx_spi_driver_data *sdd,
+			       struct spi_message *msg)
+{
+	struct s3c64xx_spi_info *sci = sdd->cntrlr_info;
+	struct spi_transfer *xfer;
+	int ret;
+
+	if (msg->is_dma_mapped || sci->dma_mode != DMA_MODE)
+		return 0;
+
+	list_for_each_entry(xfer, &msg->transfers, transfer_list) {
+		ret = s3c64xx_spi_map_one_msg(sdd, msg, xfer);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static void s3c64xx_spi_unmap_msg(struct s3c64xx_spi_driver_data *sdd,
+				  struct spi_message *msg)
+{
+	struct s3c64xx_spi_info *sci = sdd->cntrlr_info;
+	struct spi_transfer *xfer;
+
+	if (msg->is_dma_mapped || sci->dma_mode != DMA_MODE)
+		return;
+
+	list_for_each_entry(xfer, &msg->transfers, transfer_list)
+		s3c64xx_spi_unmap_one_msg(sdd, msg, xfer);
 }
 
 static int s3c64xx_spi_transfer_one_message(struct spi_master *master,
@@ -966,8 +1069,10 @@ static int s3c64xx_spi_transfer_one_message(struct spi_master *master,
 	int status = 0, cs_toggle = 0;
 	const void *origin_tx_buf = NULL;
 	void *origin_rx_buf = NULL;
+	dma_addr_t origin_tx_dma = 0, origin_rx_dma = 0;
 	unsigned int target_len = 0, origin_len = 0;
 	unsigned int fifo_lvl = (FIFO_LVL_MASK(sdd) >> 1) + 1;
+	unsigned int pio_len;
 	u32 speed;
 	u8 bpw;
 
@@ -985,15 +1090,24 @@ static int s3c64xx_spi_transfer_one_message(struct spi_master *master,
 		s3c64xx_spi_config(sdd);
 	}
 
-	if (!msg->is_dma_mapped && sci->dma_mode == DMA_MODE)
+	if (!msg->is_dma_mapped && sci->dma_mode == DMA_MODE) {
 		s3c64xx_spi_dma_initialize(sdd, msg);
 
+		/* Map the transfers if needed */
+		if (s3c64xx_spi_map_msg(sdd, msg)) {
+			dev_err(&spi->dev, "Xfer: Unable to map message buffers!\n");
+			status = -ENOMEM;
+			goto out;
+		}
+	}
+
 	/* Configure feedback delay */
 	writel(cs->fb_delay & 0x3, sdd->regs + S3C64XX_SPI_FB_CLK);
 
 	list_for_each_entry(xfer, &msg->transfers, transfer_list) {
 		unsigned long flags;
 		int use_dma;
+		bool use_irq = false;
 
 		reinit_completion(&sdd->xfer_completion);
 
@@ -1014,6 +1128,14 @@ static int s3c64xx_spi_transfer_one_message(struct spi_master *master,
 			s3c64xx_spi_config(sdd);
 		}
 
+		/*
+		 * Large PIO transfers are split into chunks the RX FIFO ready
+		 * IRQ can signal, so the CPU sleeps instead of spinning.
+		 */
+		pio_len = fifo_lvl;
+		if (pio_len > S3C64XX_SPI_POLLING_SIZE)
+			pio_len = min(pio_len, s3c64xx_spi_irq_chunk_len(sdd));
+
 		/* verify cpu mode */
 		if (sci->dma_mode != DMA_MODE) {
 			use_dma = 0;
@@ -1024,12 +1146,14 @@ static int s3c64xx_spi_transfer_one_message(struct spi_master *master,
 			origin_len = xfer->len;
 
 			target_len = xfer->len;
-			if (xfer->len > fifo_lvl)
-				xfer->len = fifo_lvl;
+			if (xfer->len > pio_len)
+				xfer->len = pio_len;
 		} else {
 			/* backup original tx, rx buf ptr & xfer length */
 			origin_tx_buf = xfer->tx_buf;
 			origin_rx_buf = xfer->rx_buf;
+			origin_tx_dma = xfer->tx_dma;
+			origin_rx_dma = xfer->rx_dma;
 			origin_len = xfer->len;
 
 			target_len = xfer->len;
@@ -1040,21 +1164,25 @@ static int s3c64xx_spi_transfer_one_message(struct spi_master *master,
 		}
 try_transfer:
 		if (sci->dma_mode == DMA_MODE) {
-			/* Map the transfer if needed */
-			if (s3c64xx_spi_map_one_msg(sdd, msg, xfer)) {
-				dev_err(&spi->dev, "Xfer: Unable to map message buffers!\n");
-				status = -ENOMEM;
-				goto out;
-			}
-
 			/*
 			 * Polling method for xfers not bigger than FIFO
-			 * capacity
+			 * capacity. Chunks of a transfer mapped as a whole
+			 * stay on DMA, the CPU must not touch its buffers.
 			 */
-			if (xfer->len <= fifo_lvl)
-				use_dma = 0;
+			if (origin_tx_dma != DMA_MAPPING_ERROR ||
+			    origin_rx_dma != DMA_MAPPING_ERROR)
+				use_dma = !msg->is_dma_mapped ||
+					  xfer->len > fifo_lvl;
 			else
-				use_dma = 1;
+				use_dma = 0;
+		}
+
+		if (!use_dma) {
+			use_irq = s3c64xx_spi_use_irq(sdd, xfer->len);
+			if (use_irq) {
+				reinit_completion(&sdd->xfer_completion);
+				s3c64xx_spi_set_rx_rdy_lvl(sdd, xfer->len);
+			}
 		}
 
 		spin_lock_irqsave(&sdd->lock, flags);
@@ -1077,9 +1205,12 @@ try_transfer:
 			enable_cs(sdd, spi);
 		}
 
+		if (use_irq)
+			s3c64xx_spi_enable_rx_irq(sdd);
+
 		spin_unlock_irqrestore(&sdd->lock, flags);
 
-		status = wait_for_xfer(sdd, xfer, use_dma);
+		status = wait_for_xfer(sdd, xfer, use_dma, use_irq);
 
 		if (status) {
 			dev_err(&spi->dev, "I/O Error: rx-%d tx-%d res:rx-%c tx-%c len-%d\n",
@@ -1102,6 +1233,15 @@ try_transfer:
 			s3c64xx_spi_dump_reg(sdd);
 			flush_fifo(sdd);
 
+			/* restore original tx, rx buf_ptr & xfer length */
+			xfer->tx_buf = origin_tx_buf;
+			xfer->rx_buf = origin_rx_buf;
+			xfer->len = origin_len;
+			if (sci->dma_mode == DMA_MODE) {
+				xfer->tx_dma = origin_tx_dma;
+				xfer->rx_dma = origin_rx_dma;
+			}
+
 			goto out;
 		}
 
@@ -1131,8 +1271,8 @@ try_transfer:
 				xfer->rx_buf += xfer->len;
 
 			if (target_len > 0) {
-				if (target_len > fifo_lvl)
-					xfer->len = fifo_lvl;
+				if (target_len > pio_len)
+					xfer->len = pio_len;
 				else
 					xfer->len = target_len;
 				goto try_transfer;
@@ -1143,15 +1283,17 @@ try_transfer:
 			xfer->rx_buf = origin_rx_buf;
 			xfer->len = origin_len;
 		} else {
-			s3c64xx_spi_unmap_one_msg(sdd, msg, xfer);
-
 			target_len -= xfer->len;
 
-			if (xfer->tx_buf)
+			if (xfer->tx_buf) {
 				xfer->tx_buf += xfer->len;
+				xfer->tx_dma += xfer->len;
+			}
 
-			if (xfer->rx_buf)
+			if (xfer->rx_buf) {
 				xfer->rx_buf += xfer->len;
+				xfer->rx_dma += xfer->len;
+			}
 
 			if (target_len > 0) {
 				if (target_len > S3C64XX_SPI_PACKET_CNT_MAX *
@@ -1166,11 +1308,15 @@ try_transfer:
 			/* restore original tx, rx buf_ptr & xfer length */
 			xfer->tx_buf = origin_tx_buf;
 			xfer->rx_buf = origin_rx_buf;
+			xfer->tx_dma = origin_tx_dma;
+			xfer->rx_dma = origin_rx_dma;
 			xfer->len = origin_len;
 		}
 	}
 
 out:
+	s3c64xx_spi_unmap_msg(sdd, msg);
+
 	if (!cs_toggle || status)
 		disable_cs(sdd, spi);
 	else
@@ -1398,6 +1544,16 @@ static irqreturn_t s3c64xx_spi_irq(int irq, void *data)
 
 	val = readl(sdd->regs + S3C64XX_SPI_STATUS);
 
+	if ((val & S3C64XX_SPI_ST_RX_FIFORDY) &&
+	    (readl(sdd->regs + S3C64XX_SPI_INT_EN) &
+	     S3C64XX_SPI_INT_RX_FIFORDY_EN)) {
+		/* Level triggered without a pending bit, mask it until the next chunk */
+		writel(readl(sdd->regs + S3C64XX_SPI_INT_EN) &
+		       ~S3C64XX_SPI_INT_RX_FIFORDY_EN,
+		       sdd->regs + S3C64XX_SPI_INT_EN);
+		complete(&sdd->xfer_completion);
+	}
+
 	if (val & S3C64XX_SPI_ST_RX_OVERRUN_ERR) {
 		clr = S3C64XX_SPI_PND_RX_OVERRUN_CLR;
 		dev_err(&spi->dev, "RX overrun\n");
@@ -1452,7 +1608,7 @@ static void s3c64xx_spi_hwinit(struct s3c64xx_spi_driver_data *sdd, int channel)
 
 	writel(S3C64XX_SPI_SLAVE_SIG_INACT, sdd->regs + S3C64XX_SPI_SLAVE_SEL);
 
-	/* Disable Interrupts - we use Polling if not DMA mode */
+	/* Disable Interrupts - PIO enables RX FIFO ready per transfer */
 	writel(0, regs + S3C64XX_SPI_INT_EN);
 
 	if (!sdd->port_conf->clk_from_cmu)
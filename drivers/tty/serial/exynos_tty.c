@@ -48,6 +48,8 @@
 #include <linux/mfd/syscon.h>
 #include <linux/regmap.h>
 #include <linux/panic_notifier.h>
+#include <linux/sizes.h>
+#include <linux/workqueue.h>
 
 #include <asm/irq.h>
 
@@ -112,6 +114,8 @@ struct exynos_uart_dma {
 	dma_cookie_t			tx_cookie;
 
 	char				*rx_buf;
+	/* Consumer offset into the cyclic RX ring */
+	unsigned int			rx_tail;
 
 	dma_addr_t			tx_transfer_addr;
 
@@ -131,6 +135,33 @@ struct uart_local_buf {
 	unsigned int index;
 };
 
+/*
+ * The IRQ and DMA paths only copy raw bytes into this ring, under
+ * port->lock.  log_work formats them into uart_local_buf and the logbuffer.
+ */
+#define UART_LOG_RING_SIZE	SZ_64K
+#define UART_LOG_REC_MAX	256
+
+#define UART_LOG_TX		0
+#define UART_LOG_RX		1
+
+struct uart_log_rec {
+	u64 time;
+	u16 len;
+	u8 dir;
+	bool logbuffer;
+};
+
+struct uart_log_ring {
+	unsigned char *buf;
+	unsigned int head;
+	unsigned int tail;
+	unsigned int dropped;
+	unsigned int dropped_reported;
+	struct work_struct work;
+	unsigned char data[UART_LOG_REC_MAX];
+};
+
 struct exynos_uart_port {
 	struct list_head		node;
 	unsigned char			rx_claimed;
@@ -185,6 +216,7 @@ struct exynos_uart_port {
 	unsigned int dbg_word_len;
 	unsigned int			uart_logging;
 	struct uart_local_buf		uart_local_buf;
+	struct uart_log_ring		log_ring;
 	struct logbuffer *log;
 	unsigned int ioctl_support;
 	unsigned int skip_suspend;
@@ -268,6 +300,12 @@ static inline void exynos_clear_bit(struct uart_port *port, int idx,
 #define EXYNOS_RX_PIO			1
 #define EXYNOS_RX_DMA			2
 
+/* ? - where has parity gone?? */
+#define S3C2410_UERSTAT_PARITY (0x1000)
+
+/* The RX DMA ring raises a callback every 1/EXYNOS_RX_DMA_PERIODS of it */
+#define EXYNOS_RX_DMA_PERIODS		4
+
 /* Baudrate definition*/
 #define MAX_BAUD	4000000
 #define MIN_BAUD	0
@@ -553,14 +591,12 @@ static void exynos_usi_init(struct uart_port *port);
 static void exynos_usi_stop(struct uart_port *port);
 
 static void uart_copy_to_local_buf(int dir, struct uart_local_buf *local_buf,
-				   unsigned char *trace_buf, int len)
+				   unsigned char *trace_buf, int len,
+				   unsigned long long time)
 {
-	unsigned long long time;
 	unsigned long rem_nsec;
 	int i;
-	int cpu = raw_smp_processor_id();
 
-	time = cpu_clock(cpu);
 	rem_nsec = do_div(time, NSEC_PER_SEC);
 
 	if (local_buf->index + (len * 3 + 30) >= local_buf->size)
@@ -591,6 +627,137 @@ static void uart_copy_to_local_buf(int dir, struct uart_local_buf *local_buf,
 				     local_buf->size - local_buf->index, "\n");
 }
 
+static void uart_log_ring_write(struct uart_log_ring *ring, unsigned int pos,
+				const void *src, unsigned int len)
+{
+	unsigned int off = pos & (UART_LOG_RING_SIZE - 1);
+	unsigned int n = min(len, UART_LOG_RING_SIZE - off);
+
+	memcpy(ring->buf + off, src, n);
+	memcpy(ring->buf, src + n, len - n);
+}
+
+static void uart_log_ring_read(struct uart_log_ring *ring, unsigned int pos,
+			       void *dst, unsigned int len)
+{
+	unsigned int off = pos & (UART_LOG_RING_SIZE - 1);
+	unsigned int n = min(len, UART_LOG_RING_SIZE - off);
+
+	memcpy(dst, ring->buf + off, n);
+	memcpy(dst + n, ring->buf, len - n);
+}
+
+/* Called with port->lock held, the only writer of ring->head */
+static void uart_log_raw(struct exynos_uart_port *ourport, int dir,
+			 bool logbuffer, const unsigned char *data, int len)
+{
+	struct uart_log_ring *ring = &ourport->log_ring;
+	struct uart_log_rec rec;
+	unsigned int head, space;
+	int n;
+
+	if (!READ_ONCE(ring->buf) || len <= 0)
+		return;
+
+	rec.time = local_clock();
+	rec.dir = dir;
+	rec.logbuffer = logbuffer;
+
+	head = ring->head;
+	/* pairs with smp_store_release() in uart_log_work() */
+	space = UART_LOG_RING_SIZE - (head - smp_load_acquire(&ring->tail));
+
+	while (len > 0) {
+		n = min(len, UART_LOG_REC_MAX);
+		if (space < sizeof(rec) + n) {
+			ring->dropped++;
+			break;
+		}
+
+		rec.len = n;
+		uart_log_ring_write(ring, head, &rec, sizeof(rec));
+		uart_log_ring_write(ring, head + sizeof(rec), data, n);
+		head += sizeof(rec) + n;
+		space -= sizeof(rec) + n;
+		data += n;
+		len -= n;
+	}
+
+	if (head == ring->head)
+		return;
+
+	/* pairs with smp_load_acquire() in uart_log_work() */
+	smp_store_release(&ring->head, head);
+	queue_work(system_unbound_wq, &ring->work);
+}
+
+static void uart_log_format(struct exynos_uart_port *ourport,
+			    struct uart_log_rec *rec, unsigned char *data)
+{
+	char buf[DATA_BYTES_PER_LINE * 3 + 1];
+	int cnt = rec->len;
+
+	if (rec->logbuffer && !IS_ERR_OR_NULL(ourport->log)) {
+		if (rec->dir == UART_LOG_TX) {
+			// reset the show_uart_logging_packets flag after HCI_RESET TX packet
+			if (cnt >= 4 && data[0] == 0x01 && data[1] == 0x03
+				&& data[2] == 0x0c && data[3] == 0x00) {
+				ourport->show_uart_logging_packets = true;
+			}
+			if (ourport->show_uart_logging_packets) {
+				hex_dump_to_buffer(data, cnt,
+					DATA_BYTES_PER_LINE, 1, buf, sizeof(buf), false);
+				logbuffer_log(ourport->log, "TX: len: %d, buf: %s", cnt, buf);
+			}
+		} else if (ourport->show_uart_logging_packets) {
+			// skip saving the BQR controller debug dump packets to logbuffer
+			if (cnt >= 5 && data[0] == 0x04 && data[1] == 0xff
+				&& data[3] == 0x58 && data[4] == 0x13) {
+				ourport->show_uart_logging_packets = false;
+			} else {
+				hex_dump_to_buffer(data, cnt,
+					DATA_BYTES_PER_LINE, 1, buf, sizeof(buf), false);
+				logbuffer_log(ourport->log,
+					"RX: len: %d, buf: %s", cnt, buf);
+			}
+		}
+	}
+
+	uart_copy_to_local_buf(rec->dir, &ourport->uart_local_buf, data, cnt,
+			       rec->time);
+}
+
+static void uart_log_work(struct work_struct *work)
+{
+	struct uart_log_ring *ring = container_of(work, struct uart_log_ring, work);
+	struct exynos_uart_port *ourport =
+		container_of(ring, struct exynos_uart_port, log_ring);
+	struct uart_log_rec rec;
+	unsigned int head, tail, dropped;
+
+	/* pairs with smp_store_release() in uart_log_raw() */
+	head = smp_load_acquire(&ring->head);
+	tail = ring->tail;
+
+	while (tail != head) {
+		uart_log_ring_read(ring, tail, &rec, sizeof(rec));
+		uart_log_ring_read(ring, tail + sizeof(rec), ring->data, rec.len);
+		tail += sizeof(rec) + rec.len;
+		/* pairs with smp_load_acquire() in uart_log_raw() */
+		smp_store_release(&ring->tail, tail);
+
+		uart_log_format(ourport, &rec, ring->data);
+	}
+
+	dropped = READ_ONCE(ring->dropped);
+	if (dropped != ring->dropped_reported) {
+		if (!IS_ERR_OR_NULL(ourport->log))
+			logbuffer_log(ourport->log, "log ring full, %u bursts dropped",
+				      dropped - ring->dropped_reported);
+		ring->dropped_reported = dropped;
+	}
+}
+
 static void exynos_serial_resetport(struct uart_port *port,
 				    struct s3c2410_uartcfg *cfg);
 static void exynos_serial_pm(struct uart_port *port, unsigned int level,
@@ -818,9 +985,9 @@ static int exynos_serial_start_tx_dma(struct exynos_uart_port *ourport,
 	dma->tx_transfer_addr = dma->tx_addr + xmit->tail;
 
 	if (ourport->uart_logging && dma->tx_size)
-		uart_copy_to_local_buf(0, &ourport->uart_local_buf,
-				       ourport->port.state->xmit.buf +
-				       xmit->tail, dma->tx_size);
+		uart_log_raw(ourport, UART_LOG_TX, false,
+			     ourport->port.state->xmit.buf + xmit->tail,
+			     dma->tx_size);
 
 	dma_sync_single_for_device(ourport->port.dev, dma->tx_transfer_addr,
 				   dma->tx_size, DMA_TO_DEVICE);
@@ -913,44 +1080,128 @@ static void exynos_serial_unthrottle(struct uart_port *port)
 }
 
 static void exynos_uart_copy_rx_to_tty(struct exynos_uart_port *ourport, struct
-				       tty_port * tty, int count)
+				       tty_port * tty, unsigned int offset,
+				       int count)
 {
 	struct exynos_uart_dma *dma = ourport->dma;
+	unsigned char *data = (unsigned char *)dma->rx_buf + offset;
 	int copied;
 
 	if (!count)
 		return;
 
-	dma_sync_single_for_cpu(ourport->port.dev, dma->rx_addr,
-				dma->rx_size, DMA_FROM_DEVICE);
+	dma_sync_single_range_for_cpu(ourport->port.dev, dma->rx_addr, offset,
+				      count, DMA_FROM_DEVICE);
 
 	ourport->port.icount.rx += count;
 	if (!tty) {
 		dev_err(ourport->port.dev, "No tty port\n");
-		return;
+		goto out;
 	}
 
 	if (ourport->uart_logging && count)
-		uart_copy_to_local_buf(1, &ourport->uart_local_buf,
-				       ourport->dma->rx_buf, count);
+		uart_log_raw(ourport, UART_LOG_RX, false, data, count);
 
-	copied = tty_insert_flip_string(tty,
-					(unsigned char *)ourport->dma->rx_buf,
-					count);
+	copied = tty_insert_flip_string(tty, data, count);
 	if (copied != count) {
-		WARN_ON(1);
-		dev_err(ourport->port.dev, "RxData copy to tty layer failed\n");
+		ourport->port.icount.buf_overrun += count - copied;
+		dev_err_ratelimited(ourport->port.dev,
+				    "RxData copy to tty layer failed\n");
 	}
+
+out:
+	dma_sync_single_range_for_device(ourport->port.dev, dma->rx_addr,
+					 offset, count, DMA_FROM_DEVICE);
+}
+
+/*
+ * Push everything the cyclic RX DMA wrote since the last flush to the tty
+ * layer. The write position is taken from the residue, so this works both
+ * from the period callback and from the idle-timeout interrupt without
+ * stopping the channel. Called with port->lock held.
+ */
+static void exynos_serial_rx_dma_flush(struct exynos_uart_port *ourport)
+{
+	struct exynos_uart_dma *dma = ourport->dma;
+	struct tty_port *t = &ourport->port.state->port;
+	struct dma_tx_state state;
+	unsigned int head;
+
+	dmaengine_tx_status(dma->rx_chan, dma->rx_cookie, &state);
+	head = dma->rx_size - state.residue;
+
+	if (head < dma->rx_tail) {
+		exynos_uart_copy_rx_to_tty(ourport, t, dma->rx_tail,
+					   dma->rx_size - dma->rx_tail);
+		dma->rx_tail = 0;
+	}
+
+	if (head > dma->rx_tail)
+		exynos_uart_copy_rx_to_tty(ourport, t, dma->rx_tail,
+					   head - dma->rx_tail);
+
+	dma->rx_tail = head == dma->rx_size ? 0 : head;
+
+	tty_flip_buffer_push(t);
+}
+
+/*
+ * Errors are not reported per byte in DMA mode; fold whatever UERSTAT has
+ * latched into the counters, but only when the error source pending bit
+ * says there is something to look at.
+ */
+static void exynos_serial_rx_errors(struct exynos_uart_port *ourport)
+{
+	struct uart_port *port = &ourport->port;
+	unsigned int uerstat;
+
+	if (!(rd_regl(port, S3C64XX_UINTSP) & S3C64XX_UINTM_ERR_MSK))
+		return;
+
+	uerstat = rd_regl(port, S3C2410_UERSTAT);
+	wr_regl(port, S3C64XX_UINTSP, S3C64XX_UINTM_ERR_MSK);
+	wr_regl(port, S3C64XX_UINTP, S3C64XX_UINTM_ERR_MSK);
+
+	if (uerstat & S3C2410_UERSTAT_BREAK)
+		port->icount.brk++;
+	if (uerstat & S3C2410_UERSTAT_FRAME)
+		port->icount.frame++;
+	if (uerstat & S3C2410_UERSTAT_OVERRUN)
+		port->icount.overrun++;
+	if (uerstat & S3C2410_UERSTAT_PARITY)
+		port->icount.parity++;
+
+	if (uerstat & S3C2410_UERSTAT_ANY) {
+		dev_err_ratelimited(port->dev, "rx error in DMA mode, rxs=0x%08x\n",
+				    uerstat);
+		if (ourport->uart_logging && !IS_ERR_OR_NULL(ourport->log))
+			logbuffer_log(ourport->log, "rxerr: rxs=0x%08x\n",
+				      uerstat);
+	}
+}
+
+static void enable_rx_pio(struct exynos_uart_port *ourport);
+
+/*
+ * Flush and terminate the RX ring and drop back to PIO. Terminating the
+ * channel also lets the DMA controller release its runtime PM reference,
+ * which a running cyclic transfer would hold forever. Called with
+ * port->lock held.
+ */
+static void exynos_serial_rx_dma_stop(struct exynos_uart_port *ourport)
+{
+	struct exynos_uart_dma *dma = ourport->dma;
+
+	dmaengine_pause(dma->rx_chan);
+	exynos_serial_rx_dma_flush(ourport);
+	dmaengine_terminate_all(dma->rx_chan);
+	enable_rx_pio(ourport);
 }
 
 static void exynos_serial_stop_rx(struct uart_port *port)
 {
 	struct exynos_uart_port *ourport = to_ourport(port);
 	struct exynos_uart_dma *dma = ourport->dma;
-	struct tty_port *t = &port->state->port;
-	struct dma_tx_state state;
-	enum dma_status dma_status;
-	unsigned int received;
 
 	if (ourport->rx_enabled) {
 		pr_debug("%s: port=%p\n", __func__, port);
@@ -960,16 +1211,8 @@ static void exynos_serial_stop_rx(struct uart_port *port)
 			disable_irq_nosync(ourport->rx_irq);
 		ourport->rx_enabled = 0;
 	}
-	if (dma && dma->rx_chan) {
-		dmaengine_pause(dma->tx_chan);
-		dma_status = dmaengine_tx_status(dma->rx_chan, dma->rx_cookie,
-						 &state);
-		if (dma_status == DMA_IN_PROGRESS || dma_status == DMA_PAUSED) {
-			received = dma->rx_bytes_requested - state.residue;
-			dmaengine_terminate_all(dma->rx_chan);
-			exynos_uart_copy_rx_to_tty(ourport, t, received);
-		}
-	}
+	if (dma && dma->rx_chan && ourport->rx_mode == EXYNOS_RX_DMA)
+		exynos_serial_rx_dma_stop(ourport);
 }
 
 static inline struct exynos_uart_info
@@ -1001,61 +1244,52 @@ static int exynos_serial_rx_fifocnt(struct exynos_uart_port *ourport,
 	return (ufstat & info->rx_fifomask) >> info->rx_fifoshift;
 }
 
-static void s3c64xx_start_rx_dma(struct exynos_uart_port *ourport);
 static void exynos_serial_rx_dma_complete(void *args)
 {
 	struct exynos_uart_port *ourport = args;
 	struct uart_port *port = &ourport->port;
-
-	struct exynos_uart_dma *dma = ourport->dma;
-	struct tty_port *t = &port->state->port;
-	struct tty_struct *tty = tty_port_tty_get(&ourport->port.state->port);
-
-	struct dma_tx_state state;
 	unsigned long flags;
-	int received;
-
-	dmaengine_tx_status(dma->rx_chan,  dma->rx_cookie, &state);
-	received  = dma->rx_bytes_requested - state.residue;
-	async_tx_ack(dma->rx_desc);
 
 	spin_lock_irqsave(&port->lock, flags);
 
-	if (received)
-		exynos_uart_copy_rx_to_tty(ourport, t, received);
-
-	if (tty) {
-		tty_flip_buffer_push(t);
-		tty_kref_put(tty);
-	}
-
-	s3c64xx_start_rx_dma(ourport);
+	if (ourport->rx_mode == EXYNOS_RX_DMA)
+		exynos_serial_rx_dma_flush(ourport);
 
 	spin_unlock_irqrestore(&port->lock, flags);
 }
 
-static void s3c64xx_start_rx_dma(struct exynos_uart_port *ourport)
+/*
+ * RX DMA runs as a cyclic transfer over the whole rx_buf, so it never has
+ * to be re-armed while data is flowing: period callbacks only advance
+ * rx_tail. The idle timeout stops it, see exynos_serial_rx_chars_dma().
+ */
+static int s3c64xx_start_rx_dma(struct exynos_uart_port *ourport)
 {
 	struct exynos_uart_dma *dma = ourport->dma;
 
 	dma_sync_single_for_device(ourport->port.dev, dma->rx_addr,
 				   dma->rx_size, DMA_FROM_DEVICE);
 
-	dma->rx_desc = dmaengine_prep_slave_single(dma->rx_chan, dma->rx_addr,
-						   dma->rx_size,
-						   DMA_DEV_TO_MEM,
-						   DMA_PREP_INTERRUPT);
+	dma->rx_desc = dmaengine_prep_dma_cyclic(dma->rx_chan, dma->rx_addr,
+						 dma->rx_size,
+						 dma->rx_size /
+						 EXYNOS_RX_DMA_PERIODS,
+						 DMA_DEV_TO_MEM,
+						 DMA_PREP_INTERRUPT);
 	if (!dma->rx_desc) {
 		dev_err(ourport->port.dev, "Unable to get desc for Rx\n");
-		return;
+		return -EBUSY;
 	}
 
 	dma->rx_desc->callback = exynos_serial_rx_dma_complete;
 	dma->rx_desc->callback_param = ourport;
 	dma->rx_bytes_requested = dma->rx_size;
+	dma->rx_tail = 0;
 
 	dma->rx_cookie = dmaengine_submit(dma->rx_desc);
 	dma_async_issue_pending(dma->rx_chan);
+
+	return 0;
 }
 
 static int exynos_serial_tx_fifocnt(struct exynos_uart_port *ourport,
@@ -1069,9 +1303,6 @@ static int exynos_serial_tx_fifocnt(struct exynos_uart_port *ourport,
 	return (ufstat & info->tx_fifomask) >> info->tx_fifoshift;
 }
 
-/* ? - where has parity gone?? */
-#define S3C2410_UERSTAT_PARITY (0x1000)
-
 static void enable_rx_dma(struct exynos_uart_port *ourport)
 {
 	struct uart_port *port = &ourport->port;
@@ -1119,35 +1350,37 @@ static void exynos_serial_rx_drain_fifo(struct exynos_uart_port *ourport);
 
 static irqreturn_t exynos_serial_rx_chars_dma(void *dev_id)
 {
-	unsigned int utrstat, ufstat, received;
+	unsigned int utrstat;
 	struct exynos_uart_port *ourport = dev_id;
 	struct uart_port *port = &ourport->port;
-	struct exynos_uart_dma *dma = ourport->dma;
-	struct tty_port *t = &port->state->port;
 	unsigned long flags;
-	struct dma_tx_state state;
 
 	utrstat = rd_regl(port, S3C2410_UTRSTAT);
-	ufstat = rd_regl(port, S3C2410_UFSTAT);
 
 	spin_lock_irqsave(&port->lock, flags);
 
 	if (!(utrstat & S3C2410_UTRSTAT_TIMEOUT) &&
-	    ourport->rx_mode == EXYNOS_RX_PIO) {
-		s3c64xx_start_rx_dma(ourport);
+	    ourport->rx_mode == EXYNOS_RX_PIO &&
+	    !s3c64xx_start_rx_dma(ourport)) {
 		enable_rx_dma(ourport);
 		wr_regl(port, S3C64XX_UINTP, S3C64XX_UINTM_RXD_MSK);
 		goto finish;
 	}
 
+	/*
+	 * While data is flowing the ring keeps running and period callbacks
+	 * push it. Once the line goes idle the ring is stopped so the DMA
+	 * controller can suspend; the next RX interrupt in PIO mode starts
+	 * it again. Whatever is left in the FIFO is drained below.
+	 */
 	if (ourport->rx_mode == EXYNOS_RX_DMA) {
-		dmaengine_pause(dma->rx_chan);
-		dmaengine_tx_status(dma->rx_chan, dma->rx_cookie, &state);
-		dmaengine_terminate_all(dma->rx_chan);
-		received = dma->rx_bytes_requested - state.residue;
-		exynos_uart_copy_rx_to_tty(ourport, t, received);
-
-		enable_rx_pio(ourport);
+		exynos_serial_rx_errors(ourport);
+		if (!(utrstat & S3C2410_UTRSTAT_TIMEOUT)) {
+			exynos_serial_rx_dma_flush(ourport);
+			wr_regl(port, S3C64XX_UINTP, S3C64XX_UINTM_RXD_MSK);
+			goto finish;
+		}
+		exynos_serial_rx_dma_stop(ourport);
 	}
 
 	exynos_serial_rx_drain_fifo(ourport);
@@ -1160,20 +1393,73 @@ finish:
 	return IRQ_HANDLED;
 }
 
-static void exynos_serial_rx_drain_fifo(struct exynos_uart_port *ourport)
+static void exynos_serial_log_rx(struct exynos_uart_port *ourport,
+				 unsigned char *data, int cnt)
+{
+	if (!ourport->uart_logging || !cnt)
+		return;
+
+	uart_log_raw(ourport, UART_LOG_RX, true, data, cnt);
+}
+
+/*
+ * Fast path for a FIFO known to hold no erroneous characters: read the
+ * bytes straight into tty flip buffer space, without a UERSTAT read per
+ * character or an intermediate copy.
+ */
+static void exynos_serial_rx_bulk(struct exynos_uart_port *ourport,
+				  unsigned int fifocnt)
 {
 	struct uart_port *port = &ourport->port;
+	struct tty_port *tport = &port->state->port;
+	unsigned char *dst;
+	int i, n;
+
+	port->icount.rx += fifocnt;
+
+	while (fifocnt) {
+		n = tty_prepare_flip_string(tport, &dst, fifocnt);
+		if (n <= 0)
+			break;
+
+		for (i = 0; i < n; i++)
+			dst[i] = rd_reg(port, S3C2410_URXH);
+
+		exynos_serial_log_rx(ourport, dst, n);
+		fifocnt -= n;
+	}
+
+	/* No room left in the tty layer, drop the rest so the FIFO drains */
+	if (fifocnt) {
+		port->icount.buf_overrun += fifocnt;
+		while (fifocnt--)
+			rd_reg(port, S3C2410_URXH);
+	}
+}
+
+/*
+ * Character-by-character path, used when the error summary says at least
+ * one byte in the FIFO carries an error, and for console/flow-controlled
+ * ports which need per-character sysrq and CONS_FLOW handling.
+ *
+ * Returns false if the RX FIFO was reset and nothing must be pushed.
+ */
+static bool exynos_serial_rx_slow(struct exynos_uart_port *ourport)
+{
+	struct uart_port *port = &ourport->port;
+	struct tty_port *tport = &port->state->port;
 	unsigned int ufcon, ch, flag, ufstat, uerstat;
 	unsigned int fifocnt = 0;
 	int max_count = port->fifosize;
-	unsigned char insert_buf[256] = {0, };
-	unsigned int insert_cnt = 0;
-	unsigned char trace_buf[256] = {0, };
+	unsigned char trace_buf[256];
 	int trace_cnt = 0;
-	char buf[DATA_BYTES_PER_LINE * 3 + 1];
 
-	exynos_set_bit(port, S3C64XX_UINTM_RXD, S3C64XX_UINTM);
-	wr_regl(port, S3C64XX_UINTP, S3C64XX_UINTM_RXD_MSK);
+	/*
+	 * Every byte read below has its UERSTAT checked, so the summary can
+	 * be cleared up front; errors arriving meanwhile set it again.
+	 */
+	wr_regl(port, S3C64XX_UINTSP, S3C64XX_UINTM_ERR_MSK);
+	wr_regl(port, S3C64XX_UINTP, S3C64XX_UINTM_ERR_MSK);
 
 	while (max_count-- > 0) {
 		/*
@@ -1205,7 +1491,7 @@ static void exynos_serial_rx_drain_fifo(struct exynos_uart_port *ourport)
 					ufcon |= S3C2410_UFCON_RESETRX;
 					wr_regl(port, S3C2410_UFCON, ufcon);
 					ourport->rx_enabled = 1;
-					return;
+					return false;
 				}
 				continue;
 			}
@@ -1257,32 +1543,39 @@ static void exynos_serial_rx_drain_fifo(struct exynos_uart_port *ourport)
 		if (uart_handle_sysrq_char(port, ch))
 			continue; /* Ignore character */
 
-		insert_buf[insert_cnt++] = ch;
-		if (ourport->uart_logging)
+		tty_insert_flip_char(tport, ch, flag);
+		if (ourport->uart_logging && trace_cnt < sizeof(trace_buf))
 			trace_buf[trace_cnt++] = ch;
 	}
 
-	if (ourport->uart_logging && trace_cnt) {
-		if (!IS_ERR_OR_NULL(ourport->log)) {
-			if (ourport->show_uart_logging_packets) {
-				// skip saving the BQR controller debug dump packets to logbuffer
-				if (trace_buf[0]==0x04 && trace_buf[1]==0xff
-					&& trace_buf[3]==0x58 && trace_buf[4]==0x13) {
-					ourport->show_uart_logging_packets = false;
-				} else {
-					hex_dump_to_buffer(trace_buf, trace_cnt,
-						DATA_BYTES_PER_LINE, 1, buf, sizeof(buf), false);
-					logbuffer_log(ourport->log,
-						"RX: len: %d, buf: %s", trace_cnt, buf);
-				}
-			}
-		}
-		uart_copy_to_local_buf(1, &ourport->uart_local_buf, trace_buf, trace_cnt);
-	}
+	exynos_serial_log_rx(ourport, trace_buf, trace_cnt);
+
+	return true;
+}
+
+static void exynos_serial_rx_drain_fifo(struct exynos_uart_port *ourport)
+{
+	struct uart_port *port = &ourport->port;
+	unsigned int ufstat, fifocnt;
+
+	exynos_set_bit(port, S3C64XX_UINTM_RXD, S3C64XX_UINTM);
+	wr_regl(port, S3C64XX_UINTP, S3C64XX_UINTM_RXD_MSK);
+
+	/*
+	 * UFSTAT is sampled before UINTSP: any byte counted here was received
+	 * before the error summary is read, so its error cannot be missed.
+	 */
+	ufstat = rd_regl(port, S3C2410_UFSTAT);
+	fifocnt = exynos_serial_rx_fifocnt(ourport, ufstat);
+
+	if (fifocnt && !uart_console(port) && !(port->flags & UPF_CONS_FLOW) &&
+	    !(rd_regl(port, S3C64XX_UINTSP) & S3C64XX_UINTM_ERR_MSK))
+		exynos_serial_rx_bulk(ourport, fifocnt);
+	else if (fifocnt && !exynos_serial_rx_slow(ourport))
+		return;
 
 	exynos_clear_bit(port, S3C64XX_UINTM_RXD, S3C64XX_UINTM);
 
-	tty_insert_flip_string(&port->state->port, insert_buf, insert_cnt);
 	tty_flip_buffer_push(&port->state->port);
 }
 
@@ -1316,9 +1609,8 @@ static irqreturn_t exynos_serial_tx_chars(int irq, void *id)
 	struct circ_buf *xmit = &port->state->xmit;
 	unsigned long flags;
 	int count = port->fifosize, dma_count = 0;
-	unsigned char trace_buf[256] = {0, };
+	unsigned char trace_buf[256];
 	int trace_cnt = 0;
-	char buf[DATA_BYTES_PER_LINE * 3 + 1];
 
 	spin_lock_irqsave(&port->lock, flags);
 
@@ -1392,21 +1684,8 @@ out:
 	if (ourport->tx_enabled)
 		exynos_clear_bit(port, S3C64XX_UINTM_TXD, S3C64XX_UINTM);
 
-	if (ourport->uart_logging && trace_cnt) {
-		if (!IS_ERR_OR_NULL(ourport->log)) {
-			// reset the show_uart_logging_packets flag after HCI_RESET TX packet
-			if (trace_buf[0]==0x01 && trace_buf[1]==0x03
-				&& trace_buf[2]==0x0c && trace_buf[3]==0x00) {
-				ourport->show_uart_logging_packets = true;
-			}
-			if (ourport->show_uart_logging_packets) {
-				hex_dump_to_buffer(trace_buf, trace_cnt,
-					DATA_BYTES_PER_LINE, 1, buf, sizeof(buf), false);
-				logbuffer_log(ourport->log, "TX: len: %d, buf: %s", trace_cnt, buf);
-			}
-		}
-		uart_copy_to_local_buf(0, &ourport->uart_local_buf, trace_buf, trace_cnt);
-	}
+	if (ourport->uart_logging && trace_cnt)
+		uart_log_raw(ourport, UART_LOG_TX, true, trace_buf, trace_cnt);
 
 	spin_unlock_irqrestore(&port->lock, flags);
 	return IRQ_HANDLED;
@@ -2601,6 +2880,7 @@ static int exynos_serial_probe(struct platform_device *pdev)
 	int port_index = probe_index;
 	int rts_trig_level;
 	char logbuf_port[6];
+	unsigned char *ring_buf;
 
 	dev_dbg(&pdev->dev, "%s %d\n", __func__, index);
 
@@ -2834,12 +3114,20 @@ static int exynos_serial_probe(struct platform_device *pdev)
 		ourport->uart_local_buf.buffer = kzalloc(LOG_BUFFER_SIZE,
 							 GFP_KERNEL);
 
-		if (!ourport->uart_local_buf.buffer) {
+		ring_buf = kzalloc(UART_LOG_RING_SIZE, GFP_KERNEL);
+
+		if (!ourport->uart_local_buf.buffer || !ring_buf) {
 			dev_err(&pdev->dev, "could not allocate buffer for UART logging\n");
+			kfree(ourport->uart_local_buf.buffer);
+			ourport->uart_local_buf.buffer = NULL;
+			kfree(ring_buf);
 			ourport->uart_logging = 0;
 		} else {
 			ourport->uart_local_buf.size = LOG_BUFFER_SIZE;
 			ourport->uart_local_buf.index = 0;
+			INIT_WORK(&ourport->log_ring.work, uart_log_work);
+			/* pairs with READ_ONCE() in uart_log_raw() */
+			smp_store_release(&ourport->log_ring.buf, ring_buf);
 		}
 	}
 
@@ -2861,14 +3149,19 @@ static int exynos_serial_remove(struct platform_device *dev)
 
 	struct exynos_uart_port *ourport = to_ourport(port);
 
+	if (port) {
+		uart_remove_one_port(&exynos_uart_drv, port);
+		if (ourport->uart_logging == 1)
+			cancel_work_sync(&ourport->log_ring.work);
+	}
+
 	if (ourport->uart_logging && !IS_ERR_OR_NULL(ourport->log)) {
 		logbuffer_unregister(ourport->log);
 	}
 
-	if (port) {
-		if (ourport->uart_logging == 1)
-			kfree(ourport->uart_local_buf.buffer);
-		uart_remove_one_port(&exynos_uart_drv, port);
+	if (port && ourport->uart_logging == 1) {
+		kfree(ourport->log_ring.buf);
+		kfree(ourport->uart_local_buf.buffer);
 	}
 
 	uart_unregister_driver(&exynos_uart_drv);
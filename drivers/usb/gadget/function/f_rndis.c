@@ -16,6 +16,7 @@
 #include <linux/module.h>
 #include <linux/device.h>
 #include <linux/etherdevice.h>
+#include <linux/hrtimer.h>
 
 #include <linux/atomic.h>
 
@@ -23,6 +24,7 @@
 #include "u_ether_configfs.h"
 #include "u_rndis.h"
 #include "rndis.h"
+#include "rndis_xfer.h"
 #include "../configfs.h"
 
 /*
@@ -66,6 +68,28 @@
  *   - MS-Windows drivers sometimes emit undocumented requests.
  */
 
+/*
+ * Downlink (device to host) packets are batched into one transfer of up to
+ * rndis_dl_max_pkt_per_xfer packet messages, bounded by the MaxTransferSize
+ * the host sent in REMOTE_NDIS_INITIALIZE_MSG.  A partly filled transfer is
+ * sent after rndis_dl_aggr_timeout_us.  Set rndis_dl_max_pkt_per_xfer to 1
+ * to send one packet per transfer.
+ */
+static unsigned int rndis_dl_max_pkt_per_xfer = 10;
+module_param(rndis_dl_max_pkt_per_xfer, uint, 0644);
+MODULE_PARM_DESC(rndis_dl_max_pkt_per_xfer,
+		 "max packets per device to host transfer");
+
+static unsigned int rndis_dl_max_xfer_size = 9216;
+module_param(rndis_dl_max_xfer_size, uint, 0644);
+MODULE_PARM_DESC(rndis_dl_max_xfer_size,
+		 "max bytes per device to host transfer");
+
+static unsigned int rndis_dl_aggr_timeout_us = 300;
+module_param(rndis_dl_aggr_timeout_us, uint, 0644);
+MODULE_PARM_DESC(rndis_dl_aggr_timeout_us,
+		 "max time a downlink packet waits for a transfer to fill up");
+
 struct f_rndis {
 	struct gether			port;
 	u8				ctrl_id, data_id;
@@ -77,6 +101,13 @@ struct f_rndis {
 	struct usb_ep			*notify;
 	struct usb_request		*notify_req;
 	atomic_t			notify_count;
+
+	/* downlink aggregation, protected by the u_ether lock */
+	struct net_device		*net;
+	struct hrtimer			tx_timer;
+	struct sk_buff			*tx_skb;
+	unsigned int			tx_pkts;
+	u32				host_max_xfer_size;
 };
 
 static inline struct f_rndis *func_to_rndis(struct usb_function *f)
@@ -367,8 +398,7 @@ static struct usb_gadget_strings *rndis_strings[] = {
 
 /*-------------------------------------------------------------------------*/
 
-static struct sk_buff *rndis_add_header(struct gether *port,
-					struct sk_buff *skb)
+static struct sk_buff *rndis_add_header_single(struct sk_buff *skb)
 {
 	struct sk_buff *skb2;
 
@@ -378,10 +408,94 @@ static struct sk_buff *rndis_add_header(struct gether *port,
 	skb2 = skb_realloc_headroom(skb, sizeof(struct rndis_packet_msg_type));
 	rndis_add_hdr(skb2);
 
-	dev_kfree_skb(skb);
+	dev_kfree_skb_any(skb);
+	return skb2;
+}
+
+static struct sk_buff *rndis_tx_flush(struct f_rndis *rndis)
+{
+	struct sk_buff *skb = rndis->tx_skb;
+
+	rndis->tx_skb = NULL;
+	rndis->tx_pkts = 0;
+
+	return skb;
+}
+
+static struct sk_buff *rndis_add_header(struct gether *port,
+					struct sk_buff *skb)
+{
+	struct f_rndis *rndis = func_to_rndis(&port->func);
+	unsigned int max_pkts = READ_ONCE(rndis_dl_max_pkt_per_xfer);
+	u32 max_size = min(READ_ONCE(rndis_dl_max_xfer_size),
+			   READ_ONCE(rndis->host_max_xfer_size));
+	struct rndis_packet_msg_type *header;
+	struct sk_buff *skb2 = NULL;
+	u32 len;
+
+	/* NULL skb: the aggregation timer expired, send what we have */
+	if (!skb)
+		return rndis_tx_flush(rndis);
+
+	/* no aggregation until the host told us its MaxTransferSize */
+	if ((max_pkts <= 1 || !max_size) && !rndis->tx_skb)
+		return rndis_add_header_single(skb);
+
+	len = sizeof(*header) + skb->len;
+
+	/* doesn't fit, send the pending transfer and start a new one */
+	if (rndis->tx_skb && rndis->tx_skb->len + len > max_size)
+		skb2 = rndis_tx_flush(rndis);
+
+	if (!rndis->tx_skb) {
+		rndis->tx_skb = alloc_skb(max(max_size, len), GFP_ATOMIC);
+		if (!rndis->tx_skb) {
+			dev_kfree_skb_any(skb);
+			return skb2;
+		}
+		hrtimer_start(&rndis->tx_timer,
+			      us_to_ktime(READ_ONCE(rndis_dl_aggr_timeout_us)),
+			      HRTIMER_MODE_REL_SOFT);
+	}
+
+	header = skb_put_zero(rndis->tx_skb, sizeof(*header));
+	header->MessageType = cpu_to_le32(RNDIS_MSG_PACKET);
+	header->MessageLength = cpu_to_le32(len);
+	header->DataOffset = cpu_to_le32(36);
+	header->DataLength = cpu_to_le32(skb->len);
+	skb_copy_bits(skb, 0, skb_put(rndis->tx_skb, skb->len), skb->len);
+	dev_kfree_skb_any(skb);
+
+	if (++rndis->tx_pkts >= max_pkts && !skb2) {
+		hrtimer_try_to_cancel(&rndis->tx_timer);
+		skb2 = rndis_tx_flush(rndis);
+	}
+
+	/* NULL tells u_ether the packet is held for a later transfer */
 	return skb2;
 }
 
+static enum hrtimer_restart rndis_tx_timeout(struct hrtimer *timer)
+{
+	struct f_rndis *rndis = container_of(timer, struct f_rndis, tx_timer);
+	netdev_tx_t ret;
+
+	/* u_ether's eth_start_xmit() calls back into rndis_add_header() */
+	ret = rndis->net->netdev_ops->ndo_start_xmit(NULL, rndis->net);
+
+	/*
+	 * No free tx request, so the pending transfer is still held. Try again
+	 * later rather than leave it waiting for the next packet.
+	 */
+	if (ret == NETDEV_TX_BUSY && READ_ONCE(rndis->tx_skb)) {
+		hrtimer_forward_now(timer,
+				    us_to_ktime(READ_ONCE(rndis_dl_aggr_timeout_us)));
+		return HRTIMER_RESTART;
+	}
+
+	return HRTIMER_NORESTART;
+}
+
 static void rndis_response_available(void *_rndis)
 {
 	struct f_rndis			*rndis = _rndis;
@@ -450,8 +564,15 @@ static void rndis_response_complete(struct usb_ep *ep, struct usb_request *req)
 static void rndis_command_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct f_rndis			*rndis = req->context;
+	rndis_init_msg_type		*init = req->buf;
 	int				status;
 
+	/* remember how much the host can take in one downlink transfer */
+	if (req->actual >= sizeof(*init) &&
+	    init->MessageType == cpu_to_le32(RNDIS_MSG_INIT))
+		WRITE_ONCE(rndis->host_max_xfer_size,
+			   le32_to_cpu(init->MaxTransferSize));
+
 	/* received RNDIS command from USB_CDC_SEND_ENCAPSULATED_COMMAND */
 //	spin_lock(&dev->lock);
 	status = rndis_msg_parser(rndis->params, (u8 *) req->buf);
@@ -591,6 +712,10 @@ static int rndis_set_alt(struct usb_function *f, unsigned intf, unsigned alt)
 		 */
 		rndis->port.cdc_filter = 0;
 
+		/* size rx requests for the uplink batches we advertise */
+		rndis->port.is_fixed = true;
+		rndis->port.fixed_out_len = rndis_ul_max_xfer_size(rndis->net->mtu);
+
 		DBG(cdev, "RNDIS RX/TX early activation ... \n");
 		net = gether_connect(&rndis->port);
 		if (IS_ERR(net))
@@ -619,6 +744,14 @@ static void rndis_disable(struct usb_function *f)
 	rndis_uninit(rndis->params);
 	gether_disconnect(&rndis->port);
 
+	/*
+	 * u_ether no longer calls rndis_add_header(), drop the backlog.  A
+	 * timer callback that is already running finds the port disconnected.
+	 */
+	hrtimer_try_to_cancel(&rndis->tx_timer);
+	dev_kfree_skb_any(rndis_tx_flush(rndis));
+	WRITE_ONCE(rndis->host_max_xfer_size, 0);
+
 	usb_ep_disable(rndis->notify);
 	rndis->notify->desc = NULL;
 }
@@ -971,6 +1104,8 @@ static void rndis_unbind(struct usb_configuration *c, struct usb_function *f)
 {
 	struct f_rndis		*rndis = func_to_rndis(f);
 
+	hrtimer_cancel(&rndis->tx_timer);
+
 	kfree(f->os_desc_table);
 	f->os_desc_n = 0;
 	usb_free_all_descriptors(f);
@@ -999,6 +1134,7 @@ static struct usb_function *rndis_alloc(struct usb_function_instance *fi)
 	rndis->manufacturer = opts->manufacturer;
 
 	rndis->port.ioport = netdev_priv(opts->net);
+	rndis->net = opts->net;
 	mutex_unlock(&opts->lock);
 	/* RNDIS activates when the host changes this filter */
 	rndis->port.cdc_filter = 0;
@@ -1007,6 +1143,10 @@ static struct usb_function *rndis_alloc(struct usb_function_instance *fi)
 	rndis->port.header_len = sizeof(struct rndis_packet_msg_type);
 	rndis->port.wrap = rndis_add_header;
 	rndis->port.unwrap = rndis_rm_hdr;
+	/* rndis_add_header() may hold packets for a batched transfer */
+	rndis->port.supports_multi_frame = true;
+	hrtimer_init(&rndis->tx_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_SOFT);
+	rndis->tx_timer.function = rndis_tx_timeout;
 
 	rndis->port.func.name = "rndis";
 	/* descriptors are per-instance copies */
@@ -38,6 +38,7 @@
 #undef	VERBOSE_DEBUG
 
 #include "rndis.h"
+#include "rndis_xfer.h"
 
 
 /* The driver for your USB chip needs to support ep0 OUT to work with
@@ -55,6 +56,22 @@ MODULE_PARM_DESC (rndis_debug, "enable debugging");
 #define rndis_debug		0
 #endif
 
+/*
+ * Number of packets the host may batch into one OUT transfer.  The rx
+ * requests of f_rndis are sized from rndis_ul_max_xfer_size() to match.
+ */
+static unsigned int rndis_ul_max_pkt_per_xfer = 3;
+module_param(rndis_ul_max_pkt_per_xfer, uint, 0444);
+MODULE_PARM_DESC(rndis_ul_max_pkt_per_xfer,
+		 "max packets per host to device transfer");
+
+u32 rndis_ul_max_xfer_size(unsigned int mtu)
+{
+	return max(rndis_ul_max_pkt_per_xfer, 1U) *
+		(mtu + sizeof(struct ethhdr) +
+		 sizeof(struct rndis_packet_msg_type) + 22);
+}
+
 #ifdef CONFIG_USB_GADGET_DEBUG_FILES
 
 #define	NAME_TEMPLATE "driver/rndis-%03d"
@@ -574,12 +591,10 @@ static int rndis_init_response(struct rndis_params *params,
 	resp->MinorVersion = cpu_to_le32(RNDIS_MINOR_VERSION);
 	resp->DeviceFlags = cpu_to_le32(RNDIS_DF_CONNECTIONLESS);
 	resp->Medium = cpu_to_le32(RNDIS_MEDIUM_802_3);
-	resp->MaxPacketsPerTransfer = cpu_to_le32(1);
-	resp->MaxTransferSize = cpu_to_le32(
-		  params->dev->mtu
-		+ sizeof(struct ethhdr)
-		+ sizeof(struct rndis_packet_msg_type)
-		+ 22);
+	resp->MaxPacketsPerTransfer =
+		cpu_to_le32(max(rndis_ul_max_pkt_per_xfer, 1U));
+	resp->MaxTransferSize =
+		cpu_to_le32(rndis_ul_max_xfer_size(params->dev->mtu));
 	resp->PacketAlignmentFactor = cpu_to_le32(0);
 	resp->AFListOffset = cpu_to_le32(0);
 	resp->AFListSize = cpu_to_le32(0);
@@ -1071,23 +1086,53 @@ int rndis_rm_hdr(struct gether *port,
 			struct sk_buff *skb,
 			struct sk_buff_head *list)
 {
-	/* tmp points to a struct rndis_packet_msg_type */
-	__le32 *tmp = (void *)skb->data;
+	struct rndis_packet_msg_type *hdr;
+	struct sk_buff *skb2;
+	u32 msg_len, data_offset, data_len;
 
-	/* MessageType, MessageLength */
-	if (cpu_to_le32(RNDIS_MSG_PACKET)
-			!= get_unaligned(tmp++)) {
-		dev_kfree_skb_any(skb);
-		return -EINVAL;
-	}
-	tmp++;
+	/*
+	 * The host may batch up to MaxPacketsPerTransfer packet messages
+	 * into one transfer.  Earlier ones are cloned, the last one reuses
+	 * the transfer skb; anything shorter than a header after it is
+	 * padding.
+	 */
+	for (;;) {
+		hdr = (void *)skb->data;
+
+		if (skb->len < sizeof(*hdr) ||
+		    cpu_to_le32(RNDIS_MSG_PACKET) !=
+				get_unaligned(&hdr->MessageType)) {
+			dev_kfree_skb_any(skb);
+			return -EINVAL;
+		}
+
+		msg_len = get_unaligned_le32(&hdr->MessageLength);
+		data_offset = get_unaligned_le32(&hdr->DataOffset) + 8;
+		data_len = get_unaligned_le32(&hdr->DataLength);
 
-	/* DataOffset, DataLength */
-	if (!skb_pull(skb, get_unaligned_le32(tmp++) + 8)) {
-		dev_kfree_skb_any(skb);
-		return -EOVERFLOW;
+		if (msg_len < sizeof(*hdr) || msg_len > skb->len ||
+		    data_offset > msg_len || data_len > msg_len - data_offset) {
+			dev_kfree_skb_any(skb);
+			return -EOVERFLOW;
+		}
+
+		if (skb->len - msg_len < sizeof(*hdr))
+			break;
+
+		skb2 = skb_clone(skb, GFP_ATOMIC);
+		if (!skb2) {
+			dev_kfree_skb_any(skb);
+			return -ENOMEM;
+		}
+		skb_pull(skb2, data_offset);
+		skb_trim(skb2, data_len);
+		skb_queue_tail(list, skb2);
+
+		skb_pull(skb, msg_len);
 	}
-	skb_trim(skb, get_unaligned_le32(tmp++));
+
+	skb_pull(skb, data_offset);
+	skb_trim(skb, data_len);
 
 	skb_queue_tail(list, skb);
 	return 0;
@@ -0,0 +1,16 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * RNDIS transfer sizing shared between rndis.c and f_rndis.c
+ *
+ * rndis.h comes from the kernel tree, so the exports this module adds
+ * next to the ones declared there live here.
+ */
+
+#ifndef _RNDIS_XFER_H
+#define _RNDIS_XFER_H
+
+#include <linux/types.h>
+
+u32 rndis_ul_max_xfer_size(unsigned int mtu);
+
+#endif /* _RNDIS_XFER_H */
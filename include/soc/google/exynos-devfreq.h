@@ -213,8 +213,13 @@ struct exynos_devfreq_data {
 
 	struct exynos_pm_domain *pm_domain;
 	unsigned long previous_freq;
-	unsigned long *time_in_state;
-	unsigned long last_stat_updated;
+	/* Per-level residency in ns, since last_stat_updated (ktime ns) */
+	u64 *time_in_state;
+	u64 last_stat_updated;
+	/* CAL switch latency histogram, max_state rows of buckets */
+	u32 *trans_lat_hist;
+	/* opp_list strictly descending, binary-searchable */
+	bool opp_sorted;
 
 	struct thermal_cooling_device *cooling_dev;
 	unsigned long cooling_state;
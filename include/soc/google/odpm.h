@@ -8,6 +8,7 @@
 #ifndef __ODPM_H
 #define __ODPM_H
 
+#include <linux/seqlock.h>
 #include <linux/mfd/samsung/s2mpg1415-meter.h>
 #include <linux/mfd/samsung/s2mpg1415.h>
 
@@ -83,6 +84,21 @@ struct odpm_channel_data {
 
 	u64 measurement_start_ms;
 	u64 acc_power_uW_sec;
+	u64 interval_power_uW_sec; /* Energy added by the last refresh */
+};
+
+/**
+ * Copy of the accumulated data published after every refresh, so that readers
+ * never have to wait for the meter.
+ */
+struct odpm_snapshot {
+	u64 acc_timestamp_ms;
+	u64 last_poll_ktime_boot_ns;
+	int rail_i[ODPM_CHANNEL_MAX];
+	u64 measurement_start_ms[ODPM_CHANNEL_MAX];
+	u64 acc_power_uW_sec[ODPM_CHANNEL_MAX];
+	u64 last_interval_ns;
+	u64 interval_power_uW_sec[ODPM_CHANNEL_MAX];
 };
 
 /**
@@ -97,14 +113,20 @@ struct odpm_info {
 
 	struct odpm_channel_data channels[ODPM_CHANNEL_MAX];
 
+	seqcount_mutex_t snapshot_seq; /* Snapshot write sequence */
+	struct odpm_snapshot snapshot;
+
 	struct workqueue_struct *work_queue;
 	struct work_struct work_refresh;
 	struct alarm alarmtimer_refresh;
 	struct wakeup_source *ws;
+	atomic_t alarm_refresh_pending; /* alarm queued work_refresh and holds ws */
 
 	struct platform_device *odpm_vbatt_en_pdev;
 
 	u64 last_poll_ktime_boot_ns;
+	u64 last_interval_ns; /* Duration covered by the last refresh */
+	u64 buffer_last_poll_ns; /* Snapshot last pushed to the IIO buffer */
 	bool sleeping;
 	bool ready;
 };
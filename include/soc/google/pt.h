@@ -74,6 +74,14 @@ ptid_t pt_client_enable(struct pt_handle *handle, int id);
  */
 ptid_t pt_client_enable_size(struct pt_handle *handle, int id, size_t *size);
 
+/*
+ * Hint the smallest size of id still useful to the client and the size it
+ * would like. The driver still decides the size; sizes given below the
+ * hints are counted per id in /proc/sys/dev/pt/<client>/<id>.
+ */
+int pt_client_set_size_hint(struct pt_handle *handle, int id, size_t min_size,
+	size_t preferred_size);
+
 /* Disable id and free its ptid */
 void pt_client_disable(struct pt_handle *handle, int id);
 
@@ -135,6 +143,12 @@ static inline ptid_t pt_client_enable(struct pt_handle *handle, int id)
 	return PT_PTID_INVALID;
 }
 
+static inline int pt_client_set_size_hint(struct pt_handle *handle, int id,
+				size_t min_size, size_t preferred_size)
+{
+	return 0;
+}
+
 static inline void pt_client_disable(struct pt_handle *handle, int id)
 {
 }